@@ -0,0 +1,28 @@
+#version 330 core
+
+// One direction of a separable Gaussian blur, drawn with texture.vert.
+// Neighbouring kernel taps are merged into a single bilinear fetch placed between the
+// two texels, so a kernel of radius r costs r / 2 + 1 fetches on each side per pass.
+in vec2 uvs;
+
+uniform sampler2D my_texture;
+
+// One source texel along the blur direction, in UV units
+uniform vec2 texel_step;
+
+// Tap 0 sits on the pixel, taps 1..num_taps-1 are mirrored on both sides
+const int MAX_TAPS = 32;
+uniform int num_taps;
+uniform float offsets[MAX_TAPS];
+uniform float weights[MAX_TAPS];
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(my_texture, uvs) * weights[0];
+    for (int i = 1; i < num_taps; ++i) {
+        vec2 offset = offsets[i] * texel_step;
+        fragColor += (texture(my_texture, uvs + offset) + texture(my_texture, uvs - offset)) * weights[i];
+    }
+}
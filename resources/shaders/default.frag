@@ -1,10 +1,18 @@
-#version 330 core
+#version 410 core
 
+// With DEFERRED defined this is the lighting pass of the deferred renderer: it is drawn as a
+// fullscreen quad and reads the surface from the G-buffer written by gbuffer.frag instead of
+// from the rasterized shape, so both paths share the lighting below.
+#ifdef DEFERRED
+uniform sampler2D g_position;   // xyz world position, w is 1 where a shape was drawn
+uniform sampler2D g_normal;     // xyz world normal, w shininess
+uniform sampler2D g_ambient;    // ka * cAmbient
+uniform sampler2D g_diffuse;    // kd * cDiffuse
+uniform sampler2D g_specular;   // ks * cSpecular
+#else
 in vec3 position_world;
 in vec3 normal_world;
 
-out vec4 fragColor;
-
 uniform float ka;
 uniform float ks;
 uniform float kd;
@@ -13,93 +21,253 @@ uniform vec4 cAmbient;
 uniform vec4 cDiffuse;
 uniform vec4 cSpecular;
 uniform float shininess;
+#endif
+
+out vec4 fragColor;
+
+// Number of lights of each type, injected by the renderer for the scene's light mix so each
+// variant only contains the loops it needs. The lights are uploaded sorted by type: directional,
+// then point, then spot lights.
+#ifndef NUM_DIRECTIONAL_LIGHTS
+#define NUM_DIRECTIONAL_LIGHTS 0
+#endif
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 0
+#endif
+#ifndef NUM_SPOT_LIGHTS
+#define NUM_SPOT_LIGHTS 0
+#endif
 
 // light directions and colors
 uniform vec3 light_directions[8];
 uniform vec3 light_colors[8];
 uniform vec3 light_positions[8];
 uniform vec3 light_atts[8];
-uniform int light_types[8];
 uniform float light_angles[8];
 uniform float light_penus[8];
 
+uniform vec3 camera_pos;
 
+#ifdef SHADOWS
+// Depth maps of the directional and spot lights, packed into one atlas by ShadowAtlas. A
+// directional light has NUM_CASCADES tiles, cascade c covering the view up to cascade_splits[c].
+#define NUM_CASCADES 4
+#define MAX_SHADOW_TILES 16
+uniform sampler2DShadow shadow_atlas;
+uniform mat4 shadow_matrices[MAX_SHADOW_TILES];  // world space to atlas uv and depth
+uniform vec4 shadow_rects[MAX_SHADOW_TILES];     // uv bounds of each tile, filtering stays inside
+uniform float shadow_texel_sizes[MAX_SHADOW_TILES]; // world size of a texel, at distance 1 for spot lights
+uniform int light_shadows[8];                    // first tile of each light, -1 if it has none
+uniform vec4 cascade_splits;
+uniform vec3 camera_forward;
 
-uniform int num_lights;
+// fraction of light i that reaches position_world
+float shadow(int i, vec3 position_world, vec3 normal_world) {
+    int tile = light_shadows[i];
+    if (tile < 0) {
+        return 1.0;
+    }
+    float texel = shadow_texel_sizes[tile];
+    if (i < NUM_DIRECTIONAL_LIGHTS) {
+        float depth = dot(position_world - camera_pos, camera_forward);
+        for (int c = 0; c < NUM_CASCADES - 1; c++) {
+            if (depth > cascade_splits[c]) {
+                tile++;
+            }
+        }
+        texel = shadow_texel_sizes[tile];
+    }
+    else {
+        texel *= distance(light_positions[i], position_world);
+    }
 
-uniform vec3 camera_pos;
+    // offsetting along the normal by about a texel keeps surfaces from shadowing themselves
+    vec4 atlas = shadow_matrices[tile] * vec4(position_world + normalize(normal_world) * 1.5 * texel, 1.0);
+    atlas.xyz /= atlas.w;
+    if (atlas.z >= 1.0) { // beyond the light's far plane
+        return 1.0;
+    }
 
-void main() {
-//    fragColor = vec4(1.0f);
-//    fragColor = vec4(abs(normal_world), 1.0);
+    // 3x3 taps of the filtered 2x2 comparison
+    vec4 rect = shadow_rects[tile];
+    vec2 texel_uv = 1.0 / vec2(textureSize(shadow_atlas, 0));
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec2 uv = clamp(atlas.xy + vec2(x, y) * texel_uv, rect.xy, rect.zw);
+            lit += texture(shadow_atlas, vec3(uv, atlas.z));
+        }
+    }
+    return lit / 9.0;
+}
 
-    fragColor = vec4(ka * cAmbient[0],
-                     ka * cAmbient[1],
-                     ka * cAmbient[2],
-                     1);
+// Distance cubes of the point lights, one cube map array per resolution tier, see PointShadows
+uniform samplerCubeArrayShadow point_shadow_tier0;
+uniform samplerCubeArrayShadow point_shadow_tier1;
+uniform samplerCubeArrayShadow point_shadow_tier2;
+uniform int point_shadow_tiers[8];       // tier of each light's cube, -1 if it has none
+uniform int point_shadow_cubes[8];       // cube within the tier's array
+uniform float point_shadow_far[8];       // distance the cube's depth is divided by
+uniform float point_shadow_sizes[8];     // texels per side of the cube's faces
 
-//    normal_world = normalize(normal_world);
+// fraction of point light i that reaches position_world
+float pointShadow(int i, vec3 position_world, vec3 normal_world) {
+    int tier = point_shadow_tiers[i];
+    if (tier < 0) {
+        return 1.0;
+    }
+    // a texel of a 90 degree face is 2 * distance / size wide
+    float texel = 2.0 * distance(light_positions[i], position_world) / point_shadow_sizes[i];
+    vec3 to_surface = position_world + normalize(normal_world) * 1.5 * texel - light_positions[i];
+    float depth = length(to_surface) / point_shadow_far[i];
+    if (depth >= 1.0) {
+        return 1.0;
+    }
+    vec4 coord = vec4(to_surface, float(point_shadow_cubes[i]));
+    if (tier == 0) {
+        return texture(point_shadow_tier0, coord, depth);
+    }
+    if (tier == 1) {
+        return texture(point_shadow_tier1, coord, depth);
+    }
+    return texture(point_shadow_tier2, coord, depth);
+}
+#endif
 
-    for (int i = 0; i < num_lights; i++) {
-        // calculate attenuation
-        vec3 light_direction = light_directions[i];
-        float fatt = 1.0;
+#ifdef LIGHT_CULLING
+// Bit i set where light i can be seen, see LightCulling. Point and spot lights whose bit is clear
+// are skipped, whatever they would add is below the renderer's cutoff.
+uniform usampler2D light_tiles;      // one mask per light_tile_size pixels of the screen
+uniform int light_tile_size;
+#ifndef DEFERRED
+uniform int shape_light_mask;        // lights that reach the shape's bounding sphere
+#endif
+#endif
+
+float attenuation(int i, vec3 position_world) {
+    float distanceToLight = distance(light_positions[i], position_world);
+//    return min(1.0f, 1/ (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight));
+    return 1.0 / (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight);
+}
 
+float spotFalloff(int i, vec3 light_direction) {
+    float cosAngle = dot(light_direction, normalize(light_directions[i]));
+    float angle = acos(cosAngle);
 
-        if (light_types[i] == 0) { // point light
-            light_direction = normalize(light_positions[i] - position_world);
-            float distanceToLight = distance(light_positions[i], position_world);
-//            fatt = min(1.0f, 1/ (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight));
-            fatt = 1.0 / (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight);
-        }
+    float theta_outer = light_angles[i];
+    float theta_inner = theta_outer - light_penus[i];
 
-        else if (light_types[i] == 2) { // spot light
-            light_direction = normalize(light_positions[i] - position_world);
-            float distanceToLight = distance(light_positions[i], position_world);
-//            fatt = min(1.0f, 1/ (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight));
-            fatt = 1.0 / (light_atts[i].x + light_atts[i].y * distanceToLight + light_atts[i].z * distanceToLight * distanceToLight);
+    if (angle <= theta_inner) { // inner cone
+        return 1.0f;
+    }
+    else if (angle <= theta_outer) { // in between
+        return -2.0 * pow((angle - theta_outer) / (theta_inner-theta_outer), 3)
+               + 3.0 * pow((angle - theta_outer) / (theta_inner -theta_outer), 2);
+    }
+    // outer cone
+    return 0.0f;
+}
 
-            float cosAngle = dot(light_direction, normalize(light_directions[i]));
-            float angle = acos(cosAngle);
+// diffuse and specular light arriving from light_direction, scaled by fatt
+vec4 shade(int i, vec3 light_direction, float fatt, vec3 position_world, vec3 normal_world,
+           vec4 diffuse, vec4 specular, float shininess) {
+    vec4 color = vec4(0.0);
 
-            float theta_outer = light_angles[i];
-            float theta_inner = theta_outer - light_penus[i];
+    // diffuse term
+    float diffuseDot = dot(normalize(normal_world), light_direction);
+    if (diffuseDot > 0) {
+//        diffuseDot = clamp(diffuseDot, 0.0, 1.0);
+        color += fatt * diffuseDot * diffuse * vec4(light_colors[i], 1.0);
+    }
 
-            if (angle <= theta_inner) { // inner cone
-                fatt *= 1.0f;
-            }
-            else if (angle <= theta_outer) { // in between
-                float falloff = -2.0 * pow((angle - theta_outer) / (theta_inner-theta_outer), 3)
-                                + 3.0 * pow((angle - theta_outer) / (theta_inner -theta_outer), 2);
+    // specular term
+    vec3 reflected_direction = reflect(normalize(-light_direction), normalize(normal_world));
+    vec3 camera_direction = normalize(camera_pos - position_world);
 
-                fatt *= falloff;
-            }
-            else { // outer cone
-                fatt *= 0.0f;
-            }
-        }
+    float specular_dot = dot(reflected_direction, camera_direction);
 
+    if (specular_dot > 0) {
+//        specular_dot = clamp(specular_dot, 0.0, 1.0);
+        specular_dot = pow(specular_dot, shininess);
+        color += fatt * specular * specular_dot * vec4(light_colors[i], 1.0);
+    }
+    return color;
+}
 
-        // diffuse term
-        float diffuseDot = dot(normalize(normal_world), light_direction);
-        if (diffuseDot > 0) {
-//            diffuseDot = clamp(diffuseDot, 0.0, 1.0);
-            fragColor += fatt * kd * diffuseDot * cDiffuse * vec4(light_colors[i], 1.0);
-        }
+void main() {
+#ifdef DEFERRED
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 position_sample = texelFetch(g_position, texel, 0);
+    if (position_sample.w == 0.0) { // background, keep the cleared color
+        discard;
+    }
+    vec3 position_world = position_sample.xyz;
+    vec4 normal_sample = texelFetch(g_normal, texel, 0);
+    vec3 normal_world = normal_sample.xyz;
+    float shininess = normal_sample.w;
+
+    vec4 ambient = texelFetch(g_ambient, texel, 0);
+    vec4 diffuse = texelFetch(g_diffuse, texel, 0);
+    vec4 specular = texelFetch(g_specular, texel, 0);
+#else
+    vec4 ambient = ka * cAmbient;
+    vec4 diffuse = kd * cDiffuse;
+    vec4 specular = ks * cSpecular;
+#endif
+
+//    fragColor = vec4(1.0f);
+//    fragColor = vec4(abs(normal_world), 1.0);
+
+    fragColor = vec4(ambient[0],
+                     ambient[1],
+                     ambient[2],
+                     1);
 
-        // specular term
-        vec3 reflected_direction = reflect(normalize(-light_direction), normalize(normal_world));
-        vec3 camera_direction = normalize(camera_pos - position_world);
+//    normal_world = normalize(normal_world);
+
+#ifdef LIGHT_CULLING
+    int light_mask = int(texelFetch(light_tiles, ivec2(gl_FragCoord.xy) / light_tile_size, 0).r);
+#ifndef DEFERRED
+    light_mask &= shape_light_mask;
+#endif
+#endif
 
-        float specular_dot = dot(reflected_direction, camera_direction);
+    for (int i = 0; i < NUM_DIRECTIONAL_LIGHTS; i++) {
+        float fatt = 1.0;
+#ifdef SHADOWS
+        fatt *= shadow(i, position_world, normal_world);
+#endif
+        fragColor += shade(i, light_directions[i], fatt, position_world, normal_world, diffuse, specular, shininess);
+    }
 
-        if (specular_dot > 0) {
-//            specular_dot = clamp(specular_dot, 0.0, 1.0);
-            specular_dot = pow(specular_dot, shininess);
-            fragColor += fatt * ks * cSpecular * specular_dot * vec4(light_colors[i], 1.0);
+    for (int i = NUM_DIRECTIONAL_LIGHTS; i < NUM_DIRECTIONAL_LIGHTS + NUM_POINT_LIGHTS; i++) {
+#ifdef LIGHT_CULLING
+        if ((light_mask & (1 << i)) == 0) {
+            continue;
         }
+#endif
+        vec3 light_direction = normalize(light_positions[i] - position_world);
+        float fatt = attenuation(i, position_world);
+#ifdef SHADOWS
+        fatt *= pointShadow(i, position_world, normal_world);
+#endif
+        fragColor += shade(i, light_direction, fatt, position_world, normal_world, diffuse, specular, shininess);
+    }
 
+    for (int i = NUM_DIRECTIONAL_LIGHTS + NUM_POINT_LIGHTS; i < NUM_DIRECTIONAL_LIGHTS + NUM_POINT_LIGHTS + NUM_SPOT_LIGHTS; i++) {
+#ifdef LIGHT_CULLING
+        if ((light_mask & (1 << i)) == 0) {
+            continue;
+        }
+#endif
+        vec3 light_direction = normalize(light_positions[i] - position_world);
+        float fatt = attenuation(i, position_world) * spotFalloff(i, light_direction);
+#ifdef SHADOWS
+        fatt *= shadow(i, position_world, normal_world);
+#endif
+        fragColor += shade(i, light_direction, fatt, position_world, normal_world, diffuse, specular, shininess);
     }
+
 //    float diffuseDot = dot(normalize(normal_world), normalize(light_directions[0]));
 //    diffuseDot = clamp(diffuseDot, 0.0, 1.0);
 
@@ -9,9 +9,19 @@ uniform mat3 model_matrix_inv_trans;
 uniform mat4 model_view;
 uniform mat4 model_proj;
 
+#ifdef CAMERA_RELATIVE
+// Large-world mode: the world origin is moved to the camera, so model_matrix only holds the offset
+// from the camera, and model_view_matrix is the whole object to view transform. Both are combined
+// in double precision on the CPU, nothing uploaded is larger than the distances in view.
+uniform mat4 model_view_matrix;
+#endif
+
 out vec3 position_world;
 out vec3 normal_world;
 
+// the depth pre-pass draws with this shader too, the color pass then tests GL_EQUAL against its depth
+invariant gl_Position;
+
 
 
 void main() {
@@ -20,7 +30,11 @@ void main() {
     normal_world = normalize(model_matrix_inv_trans * normalize(normal_object));
 
 
+#ifdef CAMERA_RELATIVE
+    gl_Position = model_proj * (model_view_matrix * vec4(position_object, 1.0));
+#else
     gl_Position = model_proj * model_view * model_matrix * vec4(position_object, 1.0);
+#endif
 //    gl_Position = model_matrix * model_view * model_proj * vec4(position_object, 1.0);
 
 }
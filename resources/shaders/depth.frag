@@ -0,0 +1,6 @@
+#version 330 core
+
+// Depth-only pass before the lit pass, see Realtime::drawDepthPrePass. Color writes are masked
+// off, so nothing is shaded here.
+void main() {
+}
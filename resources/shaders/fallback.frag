@@ -0,0 +1,22 @@
+#version 330 core
+
+// Drawn while the default.frag variant for the scene's lights is still compiling: the ambient
+// term plus a diffuse light at the camera, so the first frames already show every shape.
+in vec3 position_world;
+in vec3 normal_world;
+
+out vec4 fragColor;
+
+uniform float ka;
+uniform float kd;
+
+uniform vec4 cAmbient;
+uniform vec4 cDiffuse;
+
+uniform vec3 camera_pos;
+
+void main() {
+    vec3 camera_direction = normalize(camera_pos - position_world);
+    float diffuseDot = max(dot(normalize(normal_world), camera_direction), 0.0);
+    fragColor = vec4((ka * cAmbient + kd * diffuseDot * cDiffuse).rgb, 1.0);
+}
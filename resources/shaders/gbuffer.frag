@@ -0,0 +1,29 @@
+#version 330 core
+
+// Geometry pass of the deferred renderer: writes the surface default.frag would light into the
+// G-buffer, the lighting happens afterwards in default.frag compiled with DEFERRED.
+in vec3 position_world;
+in vec3 normal_world;
+
+layout (location = 0) out vec4 g_position;
+layout (location = 1) out vec4 g_normal;
+layout (location = 2) out vec4 g_ambient;
+layout (location = 3) out vec4 g_diffuse;
+layout (location = 4) out vec4 g_specular;
+
+uniform float ka;
+uniform float ks;
+uniform float kd;
+
+uniform vec4 cAmbient;
+uniform vec4 cDiffuse;
+uniform vec4 cSpecular;
+uniform float shininess;
+
+void main() {
+    g_position = vec4(position_world, 1.0);
+    g_normal = vec4(normalize(normal_world), shininess);
+    g_ambient = ka * cAmbient;
+    g_diffuse = kd * cDiffuse;
+    g_specular = ks * cSpecular;
+}
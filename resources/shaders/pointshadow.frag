@@ -0,0 +1,12 @@
+#version 410 core
+
+// Stores the distance to the light instead of the projected depth, so default.frag can compare
+// against the same value on every face of the cube.
+in vec3 position_world;
+
+uniform vec3 light_position;
+uniform float far_plane;
+
+void main() {
+    gl_FragDepth = distance(position_world, light_position) / far_plane;
+}
@@ -0,0 +1,9 @@
+#version 410 core
+layout (location = 0) in vec3 position_object;
+
+uniform mat4 model_matrix;
+
+// Only to world space, pointshadow.geom projects each triangle onto the faces of the cube
+void main() {
+    gl_Position = model_matrix * vec4(position_object, 1.0);
+}
@@ -0,0 +1,95 @@
+#version 330 core
+
+// One fused post-processing pass, drawn with texture.vert. PostProcessor prepends defines
+// that pick how the source is read and which per-pixel filters run on the result, e.g.
+//   #define STAGE_SHARPEN
+//   #define POST_OPS(c) c = tonemap(c); c = invert(c);
+in vec2 uvs;
+
+uniform sampler2D my_texture;
+
+// One source texel, in UV units
+uniform vec2 texel_size;
+
+uniform float sharpen_amount;
+uniform float exposure;
+
+out vec4 fragColor;
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+// Per-pixel filters
+
+vec4 invert(vec4 color) {
+    return vec4(1.0) - color;
+}
+
+vec4 grayscale(vec4 color) {
+    return vec4(vec3(luma(color.rgb)), color.a);
+}
+
+// Reinhard
+vec4 tonemap(vec4 color) {
+    vec3 x = color.rgb * exposure;
+    return vec4(x / (1.0 + x), color.a);
+}
+
+// Neighbourhood filters, reading my_texture around uvs
+
+vec4 sharpen() {
+    vec4 center = texture(my_texture, uvs);
+    vec4 neighbours = texture(my_texture, uvs + vec2(texel_size.x, 0.0))
+                    + texture(my_texture, uvs - vec2(texel_size.x, 0.0))
+                    + texture(my_texture, uvs + vec2(0.0, texel_size.y))
+                    + texture(my_texture, uvs - vec2(0.0, texel_size.y));
+    return clamp(center * (1.0 + 4.0 * sharpen_amount) - neighbours * sharpen_amount, 0.0, 1.0);
+}
+
+// FXAA in its simplest form: blur along the local edge direction, unless that overshoots the
+// range of the neighbourhood
+vec4 fxaa() {
+    const float reduceMin = 1.0 / 128.0;
+    const float reduceMul = 1.0 / 8.0;
+    const float spanMax = 8.0;
+
+    vec4 center = texture(my_texture, uvs);
+    float lumaNW = luma(texture(my_texture, uvs + vec2(-1.0, -1.0) * texel_size).rgb);
+    float lumaNE = luma(texture(my_texture, uvs + vec2( 1.0, -1.0) * texel_size).rgb);
+    float lumaSW = luma(texture(my_texture, uvs + vec2(-1.0,  1.0) * texel_size).rgb);
+    float lumaSE = luma(texture(my_texture, uvs + vec2( 1.0,  1.0) * texel_size).rgb);
+    float lumaM = luma(center.rgb);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * reduceMul, reduceMin);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-spanMax), vec2(spanMax)) * texel_size;
+
+    vec4 colorA = 0.5 * (texture(my_texture, uvs + dir * (1.0 / 3.0 - 0.5)) +
+                         texture(my_texture, uvs + dir * (2.0 / 3.0 - 0.5)));
+    vec4 colorB = colorA * 0.5 + 0.25 * (texture(my_texture, uvs - dir * 0.5) +
+                                         texture(my_texture, uvs + dir * 0.5));
+    float lumaB = luma(colorB.rgb);
+    vec4 result = (lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB;
+    return vec4(result.rgb, center.a);
+}
+
+void main()
+{
+#if defined(STAGE_SHARPEN)
+    vec4 color = sharpen();
+#elif defined(STAGE_FXAA)
+    vec4 color = fxaa();
+#else
+    vec4 color = texture(my_texture, uvs);
+#endif
+
+#ifdef POST_OPS
+    POST_OPS(color)
+#endif
+
+    fragColor = color;
+}
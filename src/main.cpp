@@ -17,6 +17,14 @@ int main(int argc, char *argv[]) {
     fmt.setProfile(QSurfaceFormat::CoreProfile);
     QSurfaceFormat::setDefaultFormat(fmt);
 
+    // Run the CPU-side benchmarks before opening the window
+    bool runBenchmarks = QCoreApplication::arguments().contains("--benchmark");
+    if (runBenchmarks) {
+        SceneParser::benchmarkFlatten(1000000);
+        CameraSimulation::benchmarkFrameRates();
+        MeshOptimizer::benchmarkOverdraw();
+    }
+
     MainWindow w;
     w.initialize();
     w.resize(800, 600);
@@ -33,6 +33,9 @@ void MainWindow::initialize() {
     QLabel *filters_label = new QLabel(); // Filters label
     filters_label->setText("Filters");
     filters_label->setFont(font);
+    QLabel *performance_label = new QLabel(); // Performance label
+    performance_label->setText("Performance");
+    performance_label->setFont(font);
     QLabel *ec_label = new QLabel(); // Extra Credit label
     ec_label->setText("Extra Credit");
     ec_label->setFont(font);
@@ -44,6 +47,16 @@ void MainWindow::initialize() {
     near_label->setText("Near Plane:");
     QLabel *far_label = new QLabel(); // Far plane label
     far_label->setText("Far Plane:");
+    QLabel *blur_radius_label = new QLabel(); // Blur radius label
+    blur_radius_label->setText("Blur Radius:");
+    QLabel *msaa_samples_label = new QLabel(); // MSAA samples label
+    msaa_samples_label->setText("MSAA Samples:");
+    QLabel *target_frame_time_label = new QLabel(); // Target frame time label
+    target_frame_time_label->setText("Target Frame Time (ms):");
+    QLabel *shadow_map_size_label = new QLabel(); // Shadow map size label
+    shadow_map_size_label->setText("Shadow Map Size:");
+    QLabel *light_cutoff_label = new QLabel(); // Light cutoff label
+    light_cutoff_label->setText("Light Cutoff:");
 
 
 
@@ -57,6 +70,105 @@ void MainWindow::initialize() {
     filter2->setText(QStringLiteral("Kernel-Based Filter"));
     filter2->setChecked(false);
 
+    // Create number box for the blur radius, in pixels
+    blurRadiusBox = new QSpinBox();
+    blurRadiusBox->setMinimum(1);
+    blurRadiusBox->setMaximum(128);
+    blurRadiusBox->setSingleStep(1);
+    blurRadiusBox->setValue(settings.blurRadius);
+
+    // Create checkboxes for the other post-processing filters
+    sharpenFilter = new QCheckBox();
+    sharpenFilter->setText(QStringLiteral("Sharpen"));
+    sharpenFilter->setChecked(false);
+
+    toneMapFilter = new QCheckBox();
+    toneMapFilter->setText(QStringLiteral("Tone Mapping"));
+    toneMapFilter->setChecked(false);
+
+    fxaaFilter = new QCheckBox();
+    fxaaFilter->setText(QStringLiteral("FXAA"));
+    fxaaFilter->setChecked(false);
+
+    // Create checkbox for the compact vertex layout
+    compactVertices = new QCheckBox();
+    compactVertices->setText(QStringLiteral("Compact Vertices"));
+    compactVertices->setChecked(false);
+
+    // Create checkbox for the compute shader post-processing backend
+    computePostProcessing = new QCheckBox();
+    computePostProcessing->setText(QStringLiteral("Compute Post-Processing"));
+    computePostProcessing->setChecked(false);
+
+    // Create checkbox for the deferred renderer
+    deferredShading = new QCheckBox();
+    deferredShading->setText(QStringLiteral("Deferred Shading"));
+    deferredShading->setChecked(false);
+
+    // Create checkboxes for the depth pre-pass and front-to-back sorting
+    depthPrePass = new QCheckBox();
+    depthPrePass->setText(QStringLiteral("Depth Pre-Pass"));
+    depthPrePass->setChecked(false);
+
+    sortFrontToBack = new QCheckBox();
+    sortFrontToBack->setText(QStringLiteral("Front-to-Back Sort"));
+    sortFrontToBack->setChecked(false);
+
+    // Create number box for the MSAA samples per pixel, the driver rounds up to a supported count
+    msaaSamplesBox = new QSpinBox();
+    msaaSamplesBox->setMinimum(1);
+    msaaSamplesBox->setMaximum(16);
+    msaaSamplesBox->setSingleStep(1);
+    msaaSamplesBox->setValue(settings.msaaSamples);
+
+    // Create checkbox and number box for dynamic resolution
+    dynamicResolution = new QCheckBox();
+    dynamicResolution->setText(QStringLiteral("Dynamic Resolution"));
+    dynamicResolution->setChecked(false);
+
+    targetFrameTimeBox = new QDoubleSpinBox();
+    targetFrameTimeBox->setMinimum(1.0f);
+    targetFrameTimeBox->setMaximum(100.0f);
+    targetFrameTimeBox->setSingleStep(0.1f);
+    targetFrameTimeBox->setValue(settings.targetFrameTime);
+
+    // Create checkbox and number box for shadows, the size is per light and shared by every tile of the atlas
+    shadows = new QCheckBox();
+    shadows->setText(QStringLiteral("Shadows"));
+    shadows->setChecked(false);
+
+    shadowMapSizeBox = new QSpinBox();
+    shadowMapSizeBox->setMinimum(256);
+    shadowMapSizeBox->setMaximum(2048);
+    shadowMapSizeBox->setSingleStep(256);
+    shadowMapSizeBox->setValue(settings.shadowMapSize);
+
+    // Create checkbox and number box for light culling, the cutoff is the brightness a light reaches down to
+    lightCulling = new QCheckBox();
+    lightCulling->setText(QStringLiteral("Light Culling"));
+    lightCulling->setChecked(false);
+
+    lightCutoffBox = new QDoubleSpinBox();
+    lightCutoffBox->setDecimals(4);
+    lightCutoffBox->setMinimum(0.0001f);
+    lightCutoffBox->setMaximum(0.1f);
+    lightCutoffBox->setSingleStep(0.001f);
+    lightCutoffBox->setValue(settings.lightCutoff);
+
+    // Create checkbox for large-world mode, scenes spanning kilometers jitter without it
+    largeWorld = new QCheckBox();
+    largeWorld->setText(QStringLiteral("Large World"));
+    largeWorld->setChecked(false);
+
+    // Create checkboxes for the depth mapping, the far plane can only go to infinity with reversed-Z
+    reversedZ = new QCheckBox();
+    reversedZ->setText(QStringLiteral("Reversed-Z"));
+    reversedZ->setChecked(false);
+
+    infiniteFar = new QCheckBox();
+    infiniteFar->setText(QStringLiteral("Infinite Far Plane"));
+    infiniteFar->setChecked(false);
+
     // Create file uploader for scene file
     uploadFile = new QPushButton();
     uploadFile->setText(QStringLiteral("Upload Scene File"));
@@ -176,6 +288,31 @@ void MainWindow::initialize() {
     vLayout->addWidget(filters_label);
     vLayout->addWidget(filter1);
     vLayout->addWidget(filter2);
+    vLayout->addWidget(blur_radius_label);
+    vLayout->addWidget(blurRadiusBox);
+    vLayout->addWidget(sharpenFilter);
+    vLayout->addWidget(toneMapFilter);
+    vLayout->addWidget(fxaaFilter);
+    vLayout->addWidget(performance_label);
+    vLayout->addWidget(compactVertices);
+    vLayout->addWidget(computePostProcessing);
+    vLayout->addWidget(deferredShading);
+    vLayout->addWidget(depthPrePass);
+    vLayout->addWidget(sortFrontToBack);
+    vLayout->addWidget(msaa_samples_label);
+    vLayout->addWidget(msaaSamplesBox);
+    vLayout->addWidget(dynamicResolution);
+    vLayout->addWidget(target_frame_time_label);
+    vLayout->addWidget(targetFrameTimeBox);
+    vLayout->addWidget(shadows);
+    vLayout->addWidget(shadow_map_size_label);
+    vLayout->addWidget(shadowMapSizeBox);
+    vLayout->addWidget(lightCulling);
+    vLayout->addWidget(light_cutoff_label);
+    vLayout->addWidget(lightCutoffBox);
+    vLayout->addWidget(largeWorld);
+    vLayout->addWidget(reversedZ);
+    vLayout->addWidget(infiniteFar);
     // Extra Credit:
     vLayout->addWidget(ec_label);
     vLayout->addWidget(ec1);
@@ -202,6 +339,21 @@ void MainWindow::finish() {
 void MainWindow::connectUIElements() {
     connectPerPixelFilter();
     connectKernelBasedFilter();
+    connectBlurRadius();
+    connectSharpenFilter();
+    connectToneMapFilter();
+    connectFxaaFilter();
+    connectCompactVertices();
+    connectComputePostProcessing();
+    connectDeferredShading();
+    connectDepthPrePass();
+    connectSortFrontToBack();
+    connectMsaaSamples();
+    connectDynamicResolution();
+    connectShadows();
+    connectLightCulling();
+    connectLargeWorld();
+    connectReversedZ();
     connectUploadFile();
     connectSaveImage();
     connectParam1();
@@ -219,6 +371,75 @@ void MainWindow::connectKernelBasedFilter() {
     connect(filter2, &QCheckBox::clicked, this, &MainWindow::onKernelBasedFilter);
 }
 
+void MainWindow::connectBlurRadius() {
+    connect(blurRadiusBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeBlurRadius);
+}
+
+void MainWindow::connectSharpenFilter() {
+    connect(sharpenFilter, &QCheckBox::clicked, this, &MainWindow::onSharpenFilter);
+}
+
+void MainWindow::connectToneMapFilter() {
+    connect(toneMapFilter, &QCheckBox::clicked, this, &MainWindow::onToneMapFilter);
+}
+
+void MainWindow::connectFxaaFilter() {
+    connect(fxaaFilter, &QCheckBox::clicked, this, &MainWindow::onFxaaFilter);
+}
+
+void MainWindow::connectCompactVertices() {
+    connect(compactVertices, &QCheckBox::clicked, this, &MainWindow::onCompactVertices);
+}
+
+void MainWindow::connectComputePostProcessing() {
+    connect(computePostProcessing, &QCheckBox::clicked, this, &MainWindow::onComputePostProcessing);
+}
+
+void MainWindow::connectDeferredShading() {
+    connect(deferredShading, &QCheckBox::clicked, this, &MainWindow::onDeferredShading);
+}
+
+void MainWindow::connectDepthPrePass() {
+    connect(depthPrePass, &QCheckBox::clicked, this, &MainWindow::onDepthPrePass);
+}
+
+void MainWindow::connectSortFrontToBack() {
+    connect(sortFrontToBack, &QCheckBox::clicked, this, &MainWindow::onSortFrontToBack);
+}
+
+void MainWindow::connectMsaaSamples() {
+    connect(msaaSamplesBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeMsaaSamples);
+}
+
+void MainWindow::connectDynamicResolution() {
+    connect(dynamicResolution, &QCheckBox::clicked, this, &MainWindow::onDynamicResolution);
+    connect(targetFrameTimeBox, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            this, &MainWindow::onValChangeTargetFrameTime);
+}
+
+void MainWindow::connectShadows() {
+    connect(shadows, &QCheckBox::clicked, this, &MainWindow::onShadows);
+    connect(shadowMapSizeBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeShadowMapSize);
+}
+
+void MainWindow::connectLightCulling() {
+    connect(lightCulling, &QCheckBox::clicked, this, &MainWindow::onLightCulling);
+    connect(lightCutoffBox, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            this, &MainWindow::onValChangeLightCutoff);
+}
+
+void MainWindow::connectLargeWorld() {
+    connect(largeWorld, &QCheckBox::clicked, this, &MainWindow::onLargeWorld);
+}
+
+void MainWindow::connectReversedZ() {
+    connect(reversedZ, &QCheckBox::clicked, this, &MainWindow::onReversedZ);
+    connect(infiniteFar, &QCheckBox::clicked, this, &MainWindow::onInfiniteFar);
+}
+
 void MainWindow::connectUploadFile() {
     connect(uploadFile, &QPushButton::clicked, this, &MainWindow::onUploadFile);
 }
@@ -268,6 +489,101 @@ void MainWindow::onKernelBasedFilter() {
     realtime->settingsChanged();
 }
 
+void MainWindow::onValChangeBlurRadius(int newValue) {
+    settings.blurRadius = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onSharpenFilter() {
+    settings.sharpenFilter = !settings.sharpenFilter;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onToneMapFilter() {
+    settings.toneMapFilter = !settings.toneMapFilter;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onFxaaFilter() {
+    settings.fxaaFilter = !settings.fxaaFilter;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onCompactVertices() {
+    settings.compactVertices = !settings.compactVertices;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onComputePostProcessing() {
+    settings.computePostProcessing = !settings.computePostProcessing;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDeferredShading() {
+    settings.deferredShading = !settings.deferredShading;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDepthPrePass() {
+    settings.depthPrePass = !settings.depthPrePass;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onSortFrontToBack() {
+    settings.sortFrontToBack = !settings.sortFrontToBack;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeMsaaSamples(int newValue) {
+    settings.msaaSamples = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDynamicResolution() {
+    settings.dynamicResolution = !settings.dynamicResolution;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeTargetFrameTime(double newValue) {
+    settings.targetFrameTime = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onShadows() {
+    settings.shadows = !settings.shadows;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeShadowMapSize(int newValue) {
+    settings.shadowMapSize = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onLightCulling() {
+    settings.lightCulling = !settings.lightCulling;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeLightCutoff(double newValue) {
+    settings.lightCutoff = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onLargeWorld() {
+    settings.largeWorld = !settings.largeWorld;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onReversedZ() {
+    settings.reversedZ = !settings.reversedZ;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onInfiniteFar() {
+    settings.infiniteFar = !settings.infiniteFar;
+    realtime->settingsChanged();
+}
+
 void MainWindow::onUploadFile() {
     // Get abs path of scene file
     QString configFilePath = QFileDialog::getOpenFileName(this, tr("Upload File"),
@@ -25,6 +25,21 @@ private:
     void connectFar();
     void connectPerPixelFilter();
     void connectKernelBasedFilter();
+    void connectBlurRadius();
+    void connectSharpenFilter();
+    void connectToneMapFilter();
+    void connectFxaaFilter();
+    void connectCompactVertices();
+    void connectComputePostProcessing();
+    void connectDeferredShading();
+    void connectDepthPrePass();
+    void connectSortFrontToBack();
+    void connectMsaaSamples();
+    void connectDynamicResolution();
+    void connectShadows();
+    void connectLightCulling();
+    void connectLargeWorld();
+    void connectReversedZ();
     void connectUploadFile();
     void connectSaveImage();
     void connectExtraCredit();
@@ -33,6 +48,25 @@ private:
     AspectRatioWidget *aspectRatioWidget;
     QCheckBox *filter1;
     QCheckBox *filter2;
+    QSpinBox *blurRadiusBox;
+    QCheckBox *sharpenFilter;
+    QCheckBox *toneMapFilter;
+    QCheckBox *fxaaFilter;
+    QCheckBox *compactVertices;
+    QCheckBox *computePostProcessing;
+    QCheckBox *deferredShading;
+    QCheckBox *depthPrePass;
+    QCheckBox *sortFrontToBack;
+    QSpinBox *msaaSamplesBox;
+    QCheckBox *dynamicResolution;
+    QDoubleSpinBox *targetFrameTimeBox;
+    QCheckBox *shadows;
+    QSpinBox *shadowMapSizeBox;
+    QCheckBox *lightCulling;
+    QDoubleSpinBox *lightCutoffBox;
+    QCheckBox *largeWorld;
+    QCheckBox *reversedZ;
+    QCheckBox *infiniteFar;
     QPushButton *uploadFile;
     QPushButton *saveImage;
     QSlider *p1Slider;
@@ -53,6 +87,25 @@ private:
 private slots:
     void onPerPixelFilter();
     void onKernelBasedFilter();
+    void onValChangeBlurRadius(int newValue);
+    void onSharpenFilter();
+    void onToneMapFilter();
+    void onFxaaFilter();
+    void onCompactVertices();
+    void onComputePostProcessing();
+    void onDeferredShading();
+    void onDepthPrePass();
+    void onSortFrontToBack();
+    void onValChangeMsaaSamples(int newValue);
+    void onDynamicResolution();
+    void onValChangeTargetFrameTime(double newValue);
+    void onShadows();
+    void onValChangeShadowMapSize(int newValue);
+    void onLightCulling();
+    void onValChangeLightCutoff(double newValue);
+    void onLargeWorld();
+    void onReversedZ();
+    void onInfiniteFar();
     void onUploadFile();
     void onSaveImage();
     void onValChangeP1(int newValue);
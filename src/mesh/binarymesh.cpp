@@ -0,0 +1,144 @@
+#include "binarymesh.h"
+#include "vertexformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char Magic[4] = {'M', 'S', 'H', 'B'};
+
+inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+std::string BinaryMesh::pathFor(const std::string &meshfile) {
+    return std::filesystem::path(meshfile).replace_extension(".mshb").string();
+}
+
+bool BinaryMesh::isBinaryMesh(const std::string &filepath) {
+    return std::filesystem::path(filepath).extension() == ".mshb";
+}
+
+bool BinaryMesh::write(const std::string &filepath, const MeshData &mesh) {
+    BinaryMeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertexCount());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.vertexStride = VertexStride;
+    header.indexSize = mesh.vertexCount() <= 0xFFFF ? 2 : 4;
+
+    // a mesh without a chain is stored as a single level
+    std::vector<BinaryMeshLod> lods;
+    for (const MeshLod &lod : mesh.lods) {
+        lods.push_back(BinaryMeshLod{lod.indexOffset, lod.indexCount, lod.error, 0});
+    }
+    if (lods.empty()) {
+        lods.push_back(BinaryMeshLod{0, header.indexCount, 0.0f, 0});
+    }
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    header.lodOffset = alignUp(sizeof(BinaryMeshHeader), 16);
+    header.vertexOffset = alignUp(header.lodOffset + lods.size() * sizeof(BinaryMeshLod), 64);
+    header.indexOffset = alignUp(header.vertexOffset + uint64_t(header.vertexCount) * VertexStride, 64);
+
+    glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    float scale = VertexFormat::scaleFor(mesh.boundsMin, mesh.boundsMax);
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+        header.center[i] = center[i];
+    }
+    header.scale = scale;
+
+    std::vector<char> bytes(header.indexOffset + uint64_t(header.indexCount) * header.indexSize, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.lodOffset, lods.data(), lods.size() * sizeof(BinaryMeshLod));
+
+    std::vector<CompactVertex> vertices = VertexFormat::pack(mesh.vertices, center, scale);
+    std::memcpy(bytes.data() + header.vertexOffset, vertices.data(), vertices.size() * sizeof(CompactVertex));
+
+    char *index = bytes.data() + header.indexOffset;
+    for (GLuint i : mesh.indices) {
+        if (header.indexSize == 2) {
+            uint16_t small = static_cast<uint16_t>(i);
+            std::memcpy(index, &small, 2);
+        } else {
+            std::memcpy(index, &i, 4);
+        }
+        index += header.indexSize;
+    }
+
+    QFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cout << "could not open " << filepath << " for writing" << std::endl;
+        return false;
+    }
+    if (file.write(bytes.data(), bytes.size()) != static_cast<qint64>(bytes.size())) {
+        std::cout << "could not write " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BinaryMesh::open(const std::string &filepath) {
+    close();
+
+    m_file = std::make_unique<QFile>(QString::fromStdString(filepath));
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        std::cout << "could not open binary mesh " << filepath << std::endl;
+        m_file.reset();
+        return false;
+    }
+
+    qint64 size = m_file->size();
+    if (size < static_cast<qint64>(sizeof(BinaryMeshHeader))) {
+        std::cout << "binary mesh " << filepath << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+
+    m_data = m_file->map(0, size);
+    if (m_data == nullptr) {
+        std::cout << "could not map binary mesh " << filepath << std::endl;
+        close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<const BinaryMeshHeader *>(m_data);
+    bool valid = std::memcmp(m_header->magic, Magic, sizeof(Magic)) == 0 &&
+                 m_header->version == Version &&
+                 m_header->vertexStride == VertexStride &&
+                 (m_header->indexSize == 2 || m_header->indexSize == 4) &&
+                 m_header->lodOffset + uint64_t(m_header->lodCount) * sizeof(BinaryMeshLod) <= uint64_t(size) &&
+                 m_header->vertexOffset + uint64_t(vertexBytes()) <= uint64_t(size) &&
+                 m_header->indexOffset + uint64_t(indexBytes()) <= uint64_t(size);
+    if (!valid) {
+        std::cout << "binary mesh " << filepath << " has an invalid or outdated header" << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void BinaryMesh::close() {
+    if (m_file && m_data) {
+        m_file->unmap(m_data);
+    }
+    m_file.reset();
+    m_data = nullptr;
+    m_header = nullptr;
+}
+
+glm::mat4 BinaryMesh::dequantizeMatrix() const {
+    glm::vec3 center(m_header->center[0], m_header->center[1], m_header->center[2]);
+    return VertexFormat::dequantizeMatrix(center, m_header->scale);
+}
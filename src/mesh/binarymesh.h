@@ -0,0 +1,83 @@
+#pragma once
+
+#include "mesh.h"
+#include "vertexformat.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <QFile>
+
+// On-disk layout of a binary mesh (.mshb). Everything is little endian.
+//   header | LOD table | vertices (vertexStride bytes each) | indices (indexSize bytes each)
+// Each vertex is a CompactVertex (see vertexformat.h) relative to the bounds.
+struct BinaryMeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;
+    uint32_t indexSize;     // 2 or 4 bytes
+    uint32_t lodCount;
+    uint32_t reserved;
+    uint64_t lodOffset;     // from the start of the file
+    uint64_t vertexOffset;  // from the start of the file
+    uint64_t indexOffset;   // from the start of the file
+    float boundsMin[3];
+    float boundsMax[3];
+    float center[3];        // position = center + scale * snorm position
+    float scale;
+};
+
+// One entry of the LOD table, see MeshLod.
+struct BinaryMeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+};
+
+// A memory-mapped binary mesh. The vertex and index pointers point straight into the
+// mapping, so they can be handed to glBufferData without an intermediate copy.
+class BinaryMesh {
+public:
+    static constexpr uint32_t Version = 3; // 3: indices and vertices are cache optimized
+    static constexpr uint32_t VertexStride = 12;
+
+    // Path of the binary mesh that sits next to a source mesh (same name, .mshb extension).
+    static std::string pathFor(const std::string &meshfile);
+
+    // True if filepath is a binary mesh.
+    static bool isBinaryMesh(const std::string &filepath);
+
+    // Quantize mesh (including its LOD chain) and write it to filepath.
+    // Returns false if the file could not be written.
+    static bool write(const std::string &filepath, const MeshData &mesh);
+
+    // Map filepath and validate its header. Returns false if the file is missing or invalid.
+    bool open(const std::string &filepath);
+    void close();
+
+    const BinaryMeshHeader &header() const { return *m_header; }
+    const BinaryMeshLod *lods() const { return reinterpret_cast<const BinaryMeshLod *>(m_data + m_header->lodOffset); }
+    const void *vertexData() const { return m_data + m_header->vertexOffset; }
+    const void *indexData() const { return m_data + m_header->indexOffset; }
+    GLsizeiptr vertexBytes() const { return GLsizeiptr(m_header->vertexCount) * m_header->vertexStride; }
+    GLsizeiptr indexBytes() const { return GLsizeiptr(m_header->indexCount) * m_header->indexSize; }
+    GLenum indexType() const { return m_header->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+    // Maps the snorm positions back to object space.
+    glm::mat4 dequantizeMatrix() const;
+
+    // Vertex attribute layout matching the packed vertices, for the currently bound VAO/VBO.
+    // Inline so the offline converter, which never uploads, doesn't link against GL.
+    static void setVertexAttributes() { VertexFormat::setCompactVertexAttributes(); }
+
+    ~BinaryMesh() { close(); }
+
+private:
+    std::unique_ptr<QFile> m_file;
+    uchar *m_data = nullptr;
+    const BinaryMeshHeader *m_header = nullptr;
+};
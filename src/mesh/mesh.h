@@ -0,0 +1,52 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+class BinaryMesh;
+
+// One level of detail: a range of MeshData::indices and the geometric error of using it.
+struct MeshLod {
+    GLuint indexOffset = 0;  // In indices, not bytes
+    GLuint indexCount = 0;
+    float error = 0.0f;      // Object-space distance from the full resolution surface
+};
+
+// Indexed triangle mesh on the CPU, using the same interleaved layout as the
+// generated primitives: position (vec3) followed by normal (vec3).
+struct MeshData {
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    std::vector<MeshLod> lods; // Level 0 is the full mesh. Empty if no chain was built.
+
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    size_t vertexCount() const { return vertices.size() / 6; }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// A mesh shared by every primitive that references the same file.
+// Loaded either from a source mesh into `data`, or from a memory-mapped binary mesh
+// that is only kept mapped until it has been uploaded.
+struct Mesh {
+    MeshData data;
+    std::unique_ptr<BinaryMesh> binary;
+
+    // Applied on top of the shape's CTM, maps quantized positions back to object space
+    glm::mat4 dequantize = glm::mat4(1.0f);
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    bool uploaded = false;
+};
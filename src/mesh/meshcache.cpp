@@ -0,0 +1,138 @@
+#include "meshcache.h"
+#include "objloader.h"
+#include "simplifier.h"
+#include "meshoptimizer.h"
+#include "vertexformat.h"
+
+#include <filesystem>
+#include <iostream>
+
+Mesh *MeshCache::get(const std::string &filepath) {
+    auto it = m_meshes.find(filepath);
+    if (it != m_meshes.end()) {
+        return it->second.get();
+    }
+
+    auto mesh = std::make_unique<Mesh>();
+    if (!loadBinary(filepath, *mesh)) {
+        if (ObjLoader::load(filepath, mesh->data)) {
+            // build the LOD chain once and persist it next to the source for the next launch
+            MeshSimplifier::buildLods(mesh->data);
+            MeshOptimizer::optimize(mesh->data, filepath);
+            if (BinaryMesh::write(BinaryMesh::pathFor(filepath), mesh->data)) {
+                std::cout << "Cached " << mesh->data.lods.size() << " LODs in " << BinaryMesh::pathFor(filepath) << std::endl;
+            }
+        }
+        else {
+            mesh.reset();
+        }
+    }
+
+    Mesh *result = mesh.get();
+    m_meshes[filepath] = std::move(mesh);
+    return result;
+}
+
+bool MeshCache::loadBinary(const std::string &filepath, Mesh &mesh) {
+    std::string binaryPath = filepath;
+    if (!BinaryMesh::isBinaryMesh(filepath)) {
+        // only use the converted file if it is newer than its source
+        binaryPath = BinaryMesh::pathFor(filepath);
+        std::error_code error;
+        auto binaryTime = std::filesystem::last_write_time(binaryPath, error);
+        if (error) {
+            return false;
+        }
+        auto sourceTime = std::filesystem::last_write_time(filepath, error);
+        if (!error && sourceTime > binaryTime) {
+            std::cout << "binary mesh " << binaryPath << " is older than its source, ignoring it" << std::endl;
+            return false;
+        }
+    }
+
+    auto binary = std::make_unique<BinaryMesh>();
+    if (!binary->open(binaryPath)) {
+        return false;
+    }
+
+    const BinaryMeshHeader &header = binary->header();
+    mesh.dequantize = binary->dequantizeMatrix();
+    mesh.data.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mesh.data.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    for (uint32_t i = 0; i < header.lodCount; i++) {
+        const BinaryMeshLod &lod = binary->lods()[i];
+        mesh.data.lods.push_back(MeshLod{lod.indexOffset, lod.indexCount, lod.error});
+    }
+    mesh.binary = std::move(binary);
+    std::cout << "Mapped binary mesh " << binaryPath << ": " << mesh.binary->header().vertexCount << " vertices, "
+              << mesh.binary->header().indexCount / 3 << " triangles" << std::endl;
+    return true;
+}
+
+void MeshCache::upload(void (*setVertexAttributes)(), bool compactVertices) {
+    for (auto &[filepath, mesh] : m_meshes) {
+        if (!mesh || mesh->uploaded) {
+            continue;
+        }
+        if (!mesh->binary && mesh->data.indices.empty()) {
+            continue;
+        }
+
+        glGenVertexArrays(1, &mesh->vao);
+        glBindVertexArray(mesh->vao);
+        glGenBuffers(1, &mesh->vbo);
+        glGenBuffers(1, &mesh->ebo);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        // The element buffer binding is stored in the VAO
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+
+        if (mesh->binary) {
+            // Upload straight from the mapping, then drop it: the driver has its own copy
+            const BinaryMesh &binary = *mesh->binary;
+            glBufferData(GL_ARRAY_BUFFER, binary.vertexBytes(), binary.vertexData(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, binary.indexBytes(), binary.indexData(), GL_STATIC_DRAW);
+            BinaryMesh::setVertexAttributes();
+
+            mesh->indexCount = static_cast<GLsizei>(binary.header().indexCount);
+            mesh->indexType = binary.indexType();
+            mesh->binary.reset();
+        }
+        else if (compactVertices) {
+            glm::vec3 center = (mesh->data.boundsMin + mesh->data.boundsMax) * 0.5f;
+            float scale = VertexFormat::scaleFor(mesh->data.boundsMin, mesh->data.boundsMax);
+            std::vector<CompactVertex> vertices = VertexFormat::pack(mesh->data.vertices, center, scale);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactVertex), vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->data.indices.size() * sizeof(GLuint), mesh->data.indices.data(), GL_STATIC_DRAW);
+            VertexFormat::setCompactVertexAttributes();
+
+            mesh->dequantize = VertexFormat::dequantizeMatrix(center, scale);
+            mesh->indexCount = static_cast<GLsizei>(mesh->data.indices.size());
+            mesh->indexType = GL_UNSIGNED_INT;
+        }
+        else {
+            glBufferData(GL_ARRAY_BUFFER, mesh->data.vertices.size() * sizeof(GLfloat), mesh->data.vertices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->data.indices.size() * sizeof(GLuint), mesh->data.indices.data(), GL_STATIC_DRAW);
+            setVertexAttributes();
+
+            mesh->indexCount = static_cast<GLsizei>(mesh->data.indices.size());
+            mesh->indexType = GL_UNSIGNED_INT;
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        mesh->uploaded = true;
+    }
+}
+
+void MeshCache::clear() {
+    for (auto &[filepath, mesh] : m_meshes) {
+        if (mesh && mesh->uploaded) {
+            glDeleteBuffers(1, &mesh->vbo);
+            glDeleteBuffers(1, &mesh->ebo);
+            glDeleteVertexArrays(1, &mesh->vao);
+        }
+    }
+    m_meshes.clear();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mesh.h"
+#include "binarymesh.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+// Owns every mesh loaded from a scene. A mesh file referenced by any number of
+// primitives is parsed and uploaded exactly once. If an up-to-date binary mesh
+// (see BinaryMesh::pathFor) sits next to the source file, it is used instead.
+class MeshCache {
+public:
+    // Returns the mesh for filepath, loading it on first use. Returns nullptr if it failed to load.
+    Mesh *get(const std::string &filepath);
+
+    // Creates the VAO/VBO/EBO for every mesh that has not been uploaded yet. Meshes loaded
+    // from a source file are packed into CompactVertex if compactVertices is set.
+    // Requires a current OpenGL context.
+    void upload(void (*setVertexAttributes)(), bool compactVertices);
+
+    // Deletes all GL resources and forgets every mesh. Requires a current OpenGL context.
+    void clear();
+
+    size_t size() const { return m_meshes.size(); }
+
+private:
+    bool loadBinary(const std::string &filepath, Mesh &mesh);
+
+    // Failed loads are cached as nullptr so a broken file is only reported once
+    std::map<std::string, std::unique_ptr<Mesh>> m_meshes;
+};
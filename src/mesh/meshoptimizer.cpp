@@ -0,0 +1,301 @@
+#include "meshoptimizer.h"
+#include "utils/benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+struct VertexKey {
+    float values[6];
+
+    bool operator==(const VertexKey &other) const {
+        return std::memcmp(values, other.values, sizeof(values)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const {
+        uint32_t bits[6];
+        std::memcpy(bits, key.values, sizeof(bits));
+        size_t h = 1469598103934665603ull;
+        for (uint32_t b : bits) {
+            h = (h ^ b) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+glm::vec3 position(const MeshData &mesh, GLuint vertex) {
+    return glm::vec3(mesh.vertices[vertex * 6], mesh.vertices[vertex * 6 + 1], mesh.vertices[vertex * 6 + 2]);
+}
+
+}
+
+MeshData MeshOptimizer::indexVertices(const std::vector<float> &vertexData) {
+    MeshData mesh;
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> vertexMap;
+    vertexMap.reserve(vertexData.size() / 6);
+    mesh.indices.reserve(vertexData.size() / 6);
+
+    for (size_t i = 0; i + 5 < vertexData.size(); i += 6) {
+        VertexKey key;
+        std::memcpy(key.values, &vertexData[i], sizeof(key.values));
+        auto [it, inserted] = vertexMap.try_emplace(key, static_cast<GLuint>(mesh.vertexCount()));
+        if (inserted) {
+            mesh.vertices.insert(mesh.vertices.end(), key.values, key.values + 6);
+        }
+        mesh.indices.push_back(it->second);
+    }
+
+    if (!mesh.vertices.empty()) {
+        mesh.boundsMin = mesh.boundsMax = position(mesh, 0);
+        for (GLuint v = 1; v < mesh.vertexCount(); v++) {
+            mesh.boundsMin = glm::min(mesh.boundsMin, position(mesh, v));
+            mesh.boundsMax = glm::max(mesh.boundsMax, position(mesh, v));
+        }
+    }
+    return mesh;
+}
+
+float MeshOptimizer::acmr(const GLuint *indices, size_t indexCount, size_t vertexCount) {
+    if (indexCount < 3) return 0.0f;
+
+    // FIFO cache, as most hardware behaves close to it
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t time = CacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i];
+        if (time - insertedAt[v] > CacheSize) {
+            insertedAt[v] = time++;
+            misses++;
+        }
+    }
+    return static_cast<float>(misses) / (indexCount / 3);
+}
+
+void MeshOptimizer::optimizeVertexCache(GLuint *indices, size_t indexCount, size_t vertexCount, std::vector<size_t> &clusters) {
+    size_t triangleCount = indexCount / 3;
+    clusters.clear();
+    if (triangleCount == 0) return;
+
+    // Triangles around each vertex
+    std::vector<GLuint> live(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) live[indices[i]]++;
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<GLuint> adjacency(indexCount);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i++) adjacency[fill[indices[i]]++] = static_cast<GLuint>(i / 3);
+    }
+
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<GLuint> deadEnd;
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> output;
+    output.reserve(indexCount);
+
+    size_t time = CacheSize + 1;
+    size_t cursor = 0;
+
+    // The current cluster's misses, simulated with a cache that starts empty at the cluster
+    std::vector<size_t> clusterCacheTime(vertexCount, 0);
+    size_t clusterTime = CacheSize + 1;
+    size_t clusterMisses = 0;
+    size_t clusterBegin = 0;
+
+    auto nextFromCursor = [&]() -> long long {
+        while (cursor < vertexCount) {
+            if (live[cursor] > 0) return static_cast<long long>(cursor++);
+            cursor++;
+        }
+        return -1;
+    };
+
+    long long fan = nextFromCursor();
+    clusters.push_back(0);
+    while (fan >= 0) {
+        candidates.clear();
+        for (size_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            GLuint t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > CacheSize) cacheTime[v] = time++;
+                if (clusterTime - clusterCacheTime[v] > CacheSize) {
+                    clusterCacheTime[v] = clusterTime++;
+                    clusterMisses++;
+                }
+            }
+        }
+
+        // Prefer a vertex that will still be in the cache once all its triangles are emitted
+        long long best = -1;
+        long long bestPriority = -1;
+        for (GLuint v : candidates) {
+            if (live[v] == 0) continue;
+            long long priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= CacheSize) priority = time - cacheTime[v];
+            if (priority > bestPriority) {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        if (best < 0) {
+            // Dead end: go back through recently used vertices, then scan for anything left
+            while (!deadEnd.empty() && best < 0) {
+                GLuint v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) best = v;
+            }
+            bool jumped = best < 0;
+            if (jumped) best = nextFromCursor();
+
+            // The cache is mostly flushed here, so starting a new cluster for the overdraw pass costs
+            // little. Clusters are only cut once their own ACMR is low enough that reordering them
+            // won't hurt the cache much (Sander et al. 2007), or where the fan jumped across the mesh.
+            size_t triangles = output.size() / 3;
+            bool cheap = clusterMisses <= ClusterAcmr * (triangles - clusterBegin);
+            if (best >= 0 && triangles > clusterBegin && (jumped || cheap)) {
+                clusters.push_back(triangles);
+                clusterBegin = triangles;
+                clusterMisses = 0;
+                clusterTime += CacheSize + 1;
+            }
+        }
+        fan = best;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(GLuint *indices, size_t indexCount, const MeshData &mesh, const std::vector<size_t> &clusters) {
+    if (clusters.size() <= 1) return;
+
+    size_t triangleCount = indexCount / 3;
+    glm::vec3 meshCentroid = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+
+    // Clusters that face away from the middle of the mesh tend to occlude the others,
+    // so they are drawn first. Sorting whole clusters keeps the cache order inside them.
+    struct Cluster {
+        size_t begin, end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = begin; t < end; t++) {
+            glm::vec3 a = position(mesh, indices[t * 3]);
+            glm::vec3 b = position(mesh, indices[t * 3 + 1]);
+            glm::vec3 c2 = position(mesh, indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c2 - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + c2) / 3.0f * triangleArea;
+            normal += n;
+            area += triangleArea;
+        }
+        if (area > 0.0f) centroid /= area;
+        float length = glm::length(normal);
+        float key = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+        sorted.push_back(Cluster{begin, end, key});
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &x, const Cluster &y) { return x.sortKey > y.sortKey; });
+
+    std::vector<GLuint> output;
+    output.reserve(indexCount);
+    for (const Cluster &cluster : sorted) {
+        output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData &mesh) {
+    // Number vertices in order of first use
+    const GLuint unused = ~0u;
+    std::vector<GLuint> remap(mesh.vertexCount(), unused);
+    GLuint next = 0;
+    for (GLuint &index : mesh.indices) {
+        if (remap[index] == unused) remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<float> vertices(size_t(next) * 6);
+    for (size_t v = 0; v < remap.size(); v++) {
+        if (remap[v] == unused) continue;
+        std::memcpy(&vertices[size_t(remap[v]) * 6], &mesh.vertices[v * 6], 6 * sizeof(float));
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+void MeshOptimizer::optimize(MeshData &mesh, const std::string &name) {
+    std::vector<MeshLod> lods = mesh.lods;
+    if (lods.empty()) {
+        lods.push_back(MeshLod{0, static_cast<GLuint>(mesh.indices.size()), 0.0f});
+    }
+
+    float before = acmr(mesh.indices.data() + lods[0].indexOffset, lods[0].indexCount, mesh.vertexCount());
+
+    std::vector<size_t> clusters;
+    for (const MeshLod &lod : lods) {
+        GLuint *indices = mesh.indices.data() + lod.indexOffset;
+        optimizeVertexCache(indices, lod.indexCount, mesh.vertexCount(), clusters);
+        optimizeOverdraw(indices, lod.indexCount, mesh, clusters);
+    }
+    optimizeVertexFetch(mesh);
+
+    float after = acmr(mesh.indices.data() + lods[0].indexOffset, lods[0].indexCount, mesh.vertexCount());
+    std::cout << "Optimized " << name << ": " << mesh.vertexCount() << " vertices, " << lods[0].indexCount / 3
+              << " triangles, ACMR " << before << " -> " << after << std::endl;
+}
+
+void MeshOptimizer::benchmarkOverdraw() {
+    // 32 x 64 quads of a unit sphere, one connected surface of 4096 triangles
+    const int rings = 32;
+    const int segments = 64;
+    std::vector<float> vertexData;
+    auto corner = [&](int ring, int segment) {
+        float phi = static_cast<float>(M_PI) * ring / rings;
+        float theta = 2.0f * static_cast<float>(M_PI) * (segment % segments) / segments;
+        glm::vec3 p = glm::vec3(std::sin(phi) * std::sin(theta), std::cos(phi), std::sin(phi) * std::cos(theta));
+        vertexData.insert(vertexData.end(), {p.x, p.y, p.z, p.x, p.y, p.z});
+    };
+    for (int s = 0; s < segments; s++) {
+        for (int r = 0; r < rings; r++) {
+            corner(r, s); corner(r + 1, s); corner(r, s + 1);
+            corner(r + 1, s); corner(r + 1, s + 1); corner(r, s + 1);
+        }
+    }
+    const MeshData sphere = indexVertices(vertexData);
+
+    MeshData mesh;
+    std::vector<size_t> clusters;
+    std::vector<GLuint> cacheOrder;
+    Benchmark::run("Vertex cache and overdraw passes, 4096 triangle sphere", 20, [&]() {
+        mesh = sphere;
+        optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), clusters);
+        cacheOrder = mesh.indices;
+        optimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh, clusters);
+    });
+
+    bool reordered = cacheOrder != mesh.indices;
+    std::cout << "Overdraw: " << clusters.size() << " clusters, ACMR "
+              << acmr(cacheOrder.data(), cacheOrder.size(), mesh.vertexCount()) << " -> "
+              << acmr(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount())
+              << (clusters.size() > 1 && reordered ? ", reordered" : ", NOT REORDERED") << std::endl;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <string>
+
+// Reorders indexed geometry for the GPU before it is uploaded:
+//  1. triangles, for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+//  2. the resulting clusters, front-facing-outward first, to reduce overdraw
+//  3. vertices, in order of first use, for vertex fetch locality
+class MeshOptimizer {
+public:
+    static constexpr int CacheSize = 16;
+    static constexpr float ClusterAcmr = 0.75f;  // Highest ACMR of a cluster that may be cut off (lambda)
+
+    // Weld identical vertices of an interleaved position/normal triangle list into an indexed mesh.
+    static MeshData indexVertices(const std::vector<float> &vertexData);
+
+    // Run all passes over every LOD range of mesh, and print the ACMR before and after.
+    static void optimize(MeshData &mesh, const std::string &name);
+
+    // Average cache miss ratio (transformed vertices per triangle) for a FIFO cache of CacheSize.
+    static float acmr(const GLuint *indices, size_t indexCount, size_t vertexCount);
+
+    // Individual passes, exposed so they can be run separately.
+    static void optimizeVertexCache(GLuint *indices, size_t indexCount, size_t vertexCount, std::vector<size_t> &clusters);
+    static void optimizeOverdraw(GLuint *indices, size_t indexCount, const MeshData &mesh, const std::vector<size_t> &clusters);
+    static void optimizeVertexFetch(MeshData &mesh);
+
+    // Runs the cache and overdraw passes over a connected sphere, printing the time, the number
+    // of clusters and whether the overdraw pass reordered them; there must be more than one.
+    static void benchmarkOverdraw();
+};
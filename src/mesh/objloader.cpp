@@ -0,0 +1,301 @@
+#include "objloader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+#include <QFile>
+
+namespace {
+
+// Index into the position or normal list. OBJ allows negative indices which are relative
+// to the end of the list at the point they are read, so those are stored relative to
+// the start of the chunk and resolved once every chunk's counts are known.
+struct ObjIndex {
+    int value = -1;
+    bool relative = false;
+};
+
+struct ObjCorner {
+    ObjIndex position;
+    ObjIndex normal;
+};
+
+struct ObjChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners; // 3 per triangle
+    bool ok = true;
+};
+
+inline const char *skipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+inline const char *skipLine(const char *p, const char *end) {
+    const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+
+inline const char *parseFloat(const char *p, const char *end, float &value) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') p++;
+    auto result = std::from_chars(p, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+inline const char *parseVec3(const char *p, const char *end, glm::vec3 &v) {
+    for (int i = 0; i < 3 && p; i++) {
+        p = parseFloat(p, end, v[i]);
+    }
+    return p;
+}
+
+// Resolve a 1-based (or negative, relative) OBJ index read while `count` elements were known.
+inline ObjIndex makeIndex(int raw, int count) {
+    ObjIndex index;
+    if (raw > 0) {
+        index.value = raw - 1;
+    } else if (raw < 0) {
+        index.value = count + raw;
+        index.relative = true;
+    }
+    return index;
+}
+
+// Parse one face corner of the form v, v/vt, v//vn or v/vt/vn.
+inline const char *parseCorner(const char *p, const char *end, const ObjChunk &chunk, ObjCorner &corner) {
+    int raw = 0;
+    auto result = std::from_chars(p, end, raw);
+    if (result.ec != std::errc()) return nullptr;
+    p = result.ptr;
+    corner.position = makeIndex(raw, static_cast<int>(chunk.positions.size()));
+
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/') {
+            // texture coordinates are not used by the renderer, skip them
+            int ignored;
+            result = std::from_chars(p, end, ignored);
+            if (result.ec == std::errc()) p = result.ptr;
+        }
+        if (p < end && *p == '/') {
+            p++;
+            result = std::from_chars(p, end, raw);
+            if (result.ec != std::errc()) return nullptr;
+            p = result.ptr;
+            corner.normal = makeIndex(raw, static_cast<int>(chunk.normals.size()));
+        }
+    }
+    return p;
+}
+
+void parseChunk(const char *p, const char *end, ObjChunk &chunk) {
+    std::vector<ObjCorner> polygon;
+    while (p < end) {
+        p = skipSpaces(p, end);
+        if (p >= end) break;
+
+        if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            glm::vec3 v;
+            if (!parseVec3(p + 2, end, v)) { chunk.ok = false; return; }
+            chunk.positions.push_back(v);
+        } else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            glm::vec3 n;
+            if (!parseVec3(p + 3, end, n)) { chunk.ok = false; return; }
+            chunk.normals.push_back(n);
+        } else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            polygon.clear();
+            const char *q = p + 2;
+            while (true) {
+                q = skipSpaces(q, end);
+                if (q >= end || *q == '\n' || *q == '#') break;
+                ObjCorner corner;
+                q = parseCorner(q, end, chunk, corner);
+                if (!q) { chunk.ok = false; return; }
+                polygon.push_back(corner);
+            }
+            // fan triangulation
+            for (size_t i = 2; i < polygon.size(); i++) {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        }
+        // everything else (vt, o, g, s, usemtl, comments, ...) is ignored
+        p = skipLine(p, end);
+    }
+}
+
+struct VertexKey {
+    glm::vec3 position;
+    glm::vec3 normal;
+
+    bool operator==(const VertexKey &other) const {
+        return std::memcmp(this, &other, sizeof(VertexKey)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const {
+        uint32_t bits[6];
+        std::memcpy(bits, &key, sizeof(bits));
+        size_t h = 1469598103934665603ull;
+        for (uint32_t b : bits) {
+            h = (h ^ b) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+}
+
+bool ObjLoader::parse(const char *begin, const char *end, MeshData &mesh) {
+    mesh = MeshData();
+
+    // Split into line-aligned chunks, at least 1 MB each
+    size_t size = end - begin;
+    size_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t numChunks = std::clamp<size_t>(size / (1 << 20), 1, numThreads);
+
+    std::vector<const char *> bounds(numChunks + 1, end);
+    bounds[0] = begin;
+    for (size_t i = 1; i < numChunks; i++) {
+        const char *p = std::max(bounds[i - 1], begin + i * size / numChunks);
+        bounds[i] = p == begin ? p : skipLine(p - 1, end);
+    }
+
+    std::vector<ObjChunk> chunks(numChunks);
+    if (numChunks == 1) {
+        parseChunk(bounds[0], bounds[1], chunks[0]);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < numChunks; i++) {
+            threads.emplace_back(parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Concatenate the chunks, resolving chunk-relative indices
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::ivec2> corners; // (position, normal), normal is -1 if absent
+    size_t totalCorners = 0;
+    for (auto &chunk : chunks) {
+        if (!chunk.ok) {
+            std::cout << "could not parse obj data" << std::endl;
+            return false;
+        }
+        totalCorners += chunk.corners.size();
+    }
+    corners.reserve(totalCorners);
+
+    for (auto &chunk : chunks) {
+        int positionOffset = static_cast<int>(positions.size());
+        int normalOffset = static_cast<int>(normals.size());
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        for (const ObjCorner &corner : chunk.corners) {
+            int p = corner.position.value + (corner.position.relative ? positionOffset : 0);
+            int n = corner.normal.value + (corner.normal.relative ? normalOffset : 0);
+            corners.push_back(glm::ivec2(p, n));
+        }
+    }
+
+    bool hasNormals = true;
+    for (const glm::ivec2 &corner : corners) {
+        if (corner.x < 0 || corner.x >= static_cast<int>(positions.size()) ||
+            corner.y >= static_cast<int>(normals.size())) {
+            std::cout << "obj face references a vertex that does not exist" << std::endl;
+            return false;
+        }
+        hasNormals &= corner.y >= 0;
+    }
+
+    // Generate area-weighted smooth normals if the file does not provide them
+    if (!hasNormals) {
+        normals.assign(positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+            glm::vec3 a = positions[corners[i].x];
+            glm::vec3 b = positions[corners[i + 1].x];
+            glm::vec3 c = positions[corners[i + 2].x];
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            for (int k = 0; k < 3; k++) {
+                normals[corners[i + k].x] += faceNormal;
+            }
+        }
+        for (auto &corner : corners) {
+            corner.y = corner.x;
+        }
+    }
+
+    // Weld corners with identical attributes into shared, indexed vertices
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> vertexMap;
+    vertexMap.reserve(positions.size());
+    mesh.indices.reserve(corners.size());
+    mesh.vertices.reserve(positions.size() * 6);
+
+    for (const glm::ivec2 &corner : corners) {
+        VertexKey key;
+        key.position = positions[corner.x];
+        glm::vec3 normal = normals[corner.y];
+        key.normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+        auto [it, inserted] = vertexMap.try_emplace(key, static_cast<GLuint>(mesh.vertexCount()));
+        if (inserted) {
+            mesh.vertices.insert(mesh.vertices.end(), {key.position.x, key.position.y, key.position.z,
+                                                       key.normal.x, key.normal.y, key.normal.z});
+        }
+        mesh.indices.push_back(it->second);
+    }
+
+    if (!mesh.vertices.empty()) {
+        mesh.boundsMin = mesh.boundsMax = glm::vec3(mesh.vertices[0], mesh.vertices[1], mesh.vertices[2]);
+        for (size_t i = 0; i < mesh.vertices.size(); i += 6) {
+            glm::vec3 p(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+            mesh.boundsMin = glm::min(mesh.boundsMin, p);
+            mesh.boundsMax = glm::max(mesh.boundsMax, p);
+        }
+    }
+
+    return true;
+}
+
+bool ObjLoader::load(const std::string &filepath, MeshData &mesh) {
+    QFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cout << "could not open mesh " << filepath << std::endl;
+        return false;
+    }
+
+    if (file.size() == 0) {
+        std::cout << "mesh " << filepath << " is empty" << std::endl;
+        return false;
+    }
+
+    // Map the whole file instead of reading it into a buffer
+    uchar *data = file.map(0, file.size());
+    if (data == nullptr) {
+        std::cout << "could not map mesh " << filepath << std::endl;
+        return false;
+    }
+
+    const char *begin = reinterpret_cast<const char *>(data);
+    bool success = parse(begin, begin + file.size(), mesh);
+    file.unmap(data);
+
+    if (!success) {
+        std::cout << "could not parse mesh " << filepath << std::endl;
+        return false;
+    }
+
+    std::cout << "Loaded mesh " << filepath << ": " << mesh.vertexCount() << " vertices, "
+              << mesh.triangleCount() << " triangles" << std::endl;
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <string>
+
+class ObjLoader {
+public:
+    // Load a Wavefront OBJ file into an indexed, welded triangle mesh.
+    // The file is memory-mapped and split into line-aligned chunks that are parsed in parallel.
+    // Polygons are fan-triangulated, and smooth normals are generated if the file has none.
+    // @param filepath  The path of the .obj file to load.
+    // @param mesh      On return, this will contain the mesh data.
+    // @return          A boolean value indicating whether the load was successful.
+    static bool load(const std::string &filepath, MeshData &mesh);
+
+    // Same as above, but parses an in-memory buffer.
+    static bool parse(const char *begin, const char *end, MeshData &mesh);
+};
@@ -0,0 +1,266 @@
+#include "simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Symmetric 4x4 error quadric of a set of weighted planes, sum of w * (n.p + d)^2.
+struct Quadric {
+    double weight = 0;
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    void addPlane(glm::dvec3 n, double d, double weight) {
+        a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+        a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+        a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+        a33 += weight * d * d;
+        this->weight += weight;
+    }
+
+    void add(const Quadric &q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+        weight += q.weight;
+    }
+
+    // Weighted mean squared distance from p to the planes
+    double evaluate(glm::dvec3 p) const {
+        double result = a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + 2 * a03 * p.x
+                      + a11 * p.y * p.y + 2 * a12 * p.y * p.z + 2 * a13 * p.y
+                      + a22 * p.z * p.z + 2 * a23 * p.z
+                      + a33;
+        return weight > 0.0 ? std::max(result, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    GLuint from;
+    GLuint to;
+    double cost;
+};
+
+inline uint64_t edgeKey(GLuint a, GLuint b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+}
+
+std::vector<GLuint> MeshSimplifier::simplify(const MeshData &mesh, const std::vector<GLuint> &indices,
+                                             size_t targetIndexCount, float &error) {
+    error = 0.0f;
+    size_t vertexCount = mesh.vertexCount();
+
+    std::vector<glm::dvec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        positions[i] = glm::dvec3(mesh.vertices[i * 6], mesh.vertices[i * 6 + 1], mesh.vertices[i * 6 + 2]);
+    }
+
+    // Vertices that only differ by their normal are one vertex as far as topology is concerned
+    std::vector<GLuint> canonical(vertexCount);
+    std::vector<std::vector<GLuint>> wedges(vertexCount); // attribute vertices of each canonical vertex
+    {
+        std::unordered_map<uint64_t, std::vector<GLuint>> buckets;
+        for (GLuint i = 0; i < vertexCount; i++) {
+            glm::vec3 p = glm::vec3(positions[i]);
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            uint64_t hash = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) * 19349663u) ^ (uint64_t(bits[2]) * 83492791u);
+            canonical[i] = i;
+            for (GLuint other : buckets[hash]) {
+                if (positions[other] == positions[i]) {
+                    canonical[i] = other;
+                    break;
+                }
+            }
+            if (canonical[i] == i) buckets[hash].push_back(i);
+            wedges[canonical[i]].push_back(i);
+        }
+    }
+
+    // Collapses work on the welded topology in result, while corners keeps the attribute vertex
+    // each triangle corner is drawn with, so split normals survive into every level
+    std::vector<GLuint> corners = indices;
+    std::vector<GLuint> result(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        result[i] = canonical[indices[i]];
+    }
+    // A seam vertex has several normals; it may be collapsed onto, but never moves
+    auto seam = [&](GLuint v) { return wedges[v].size() > 1; };
+    auto normal = [&](GLuint v) {
+        return glm::vec3(mesh.vertices[v * 6 + 3], mesh.vertices[v * 6 + 4], mesh.vertices[v * 6 + 5]);
+    };
+
+    // Accumulate the quadrics of every triangle's plane, weighted by area
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<uint64_t, int> edgeUse;
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        GLuint v[3] = {result[i], result[i + 1], result[i + 2]};
+        glm::dvec3 n = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+        double area = glm::length(n);
+        if (area > 0.0) {
+            n /= area;
+            double d = -glm::dot(n, positions[v[0]]);
+            for (GLuint k : v) quadrics[k].addPlane(n, d, area * 0.5);
+        }
+        for (int e = 0; e < 3; e++) edgeUse[edgeKey(v[e], v[(e + 1) % 3])]++;
+    }
+
+    // Keep open boundaries in place with a heavily weighted plane through each boundary edge
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        GLuint v[3] = {result[i], result[i + 1], result[i + 2]};
+        glm::dvec3 faceNormal = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+        for (int e = 0; e < 3; e++) {
+            GLuint a = v[e], b = v[(e + 1) % 3];
+            if (edgeUse[edgeKey(a, b)] != 1) continue;
+            glm::dvec3 edge = positions[b] - positions[a];
+            glm::dvec3 n = glm::cross(edge, faceNormal);
+            double length = glm::length(n);
+            if (length <= 0.0) continue;
+            n /= length;
+            double d = -glm::dot(n, positions[a]);
+            double weight = glm::dot(edge, edge) * 100.0;
+            quadrics[a].addPlane(n, d, weight);
+            quadrics[b].addPlane(n, d, weight);
+        }
+    }
+
+    std::vector<GLuint> remap(vertexCount);
+    std::vector<GLuint> attributeRemap(vertexCount);
+    std::vector<char> locked(vertexCount);
+    std::unordered_set<uint64_t> edges;
+    std::vector<std::vector<size_t>> vertexTriangles(vertexCount);
+    double maxCost = 0.0;
+
+    while (result.size() > targetIndexCount) {
+        // Triangles around each vertex, for the flip test
+        for (auto &triangles : vertexTriangles) triangles.clear();
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) vertexTriangles[result[i + k]].push_back(i);
+        }
+
+        // Cheapest direction for every edge, whichever way round its triangles use it
+        std::vector<Collapse> collapses;
+        collapses.reserve(result.size());
+        edges.clear();
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                GLuint a = result[i + e], b = result[i + (e + 1) % 3];
+                if ((seam(a) && seam(b)) || !edges.insert(edgeKey(a, b)).second) continue;
+                Quadric q = quadrics[a];
+                q.add(quadrics[b]);
+                double costAB = seam(a) ? std::numeric_limits<double>::infinity() : q.evaluate(positions[b]);
+                double costBA = seam(b) ? std::numeric_limits<double>::infinity() : q.evaluate(positions[a]);
+                collapses.push_back(costAB <= costBA ? Collapse{a, b, costAB} : Collapse{b, a, costBA});
+            }
+        }
+        if (collapses.empty()) break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        for (GLuint i = 0; i < vertexCount; i++) remap[i] = attributeRemap[i] = i;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        // Each collapse removes about two triangles
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t budget = std::max<size_t>(1, trianglesToRemove / 2);
+        size_t performed = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if (performed >= budget) break;
+            if (locked[collapse.from] || locked[collapse.to]) continue;
+
+            // Reject the collapse if moving `from` onto `to` flips any remaining triangle
+            bool flips = false;
+            for (size_t t : vertexTriangles[collapse.from]) {
+                GLuint v[3] = {result[t], result[t + 1], result[t + 2]};
+                if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to) continue;
+                glm::dvec3 before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = positions[v[k]];
+                    after[k] = v[k] == collapse.from ? positions[collapse.to] : positions[v[k]];
+                }
+                glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(n0, n1) <= 0.0) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) continue;
+
+            remap[collapse.from] = collapse.to;
+
+            // from has a single normal; its corners take the one of to's closest to it
+            GLuint fromAttribute = wedges[collapse.from][0];
+            GLuint toAttribute = wedges[collapse.to][0];
+            for (GLuint w : wedges[collapse.to]) {
+                if (glm::dot(normal(w), normal(fromAttribute)) > glm::dot(normal(toAttribute), normal(fromAttribute))) {
+                    toAttribute = w;
+                }
+            }
+            attributeRemap[fromAttribute] = toAttribute;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+
+            // Lock the neighbourhood so the next collapses see up to date triangles
+            for (size_t t : vertexTriangles[collapse.from]) {
+                for (int k = 0; k < 3; k++) locked[result[t + k]] = 1;
+            }
+            for (size_t t : vertexTriangles[collapse.to]) {
+                for (int k = 0; k < 3; k++) locked[result[t + k]] = 1;
+            }
+            performed++;
+        }
+
+        if (performed == 0) break;
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            for (int k = 0; k < 3; k++) {
+                corners[write] = attributeRemap[corners[i + k]];
+                result[write++] = remap[result[i + k]];
+            }
+        }
+        result.resize(write);
+        corners.resize(write);
+    }
+
+    // The quadric cost is a mean squared distance to the original planes
+    error = static_cast<float>(std::sqrt(maxCost));
+    return corners;
+}
+
+void MeshSimplifier::buildLods(MeshData &mesh) {
+    const size_t maxLevels = 8;
+    const size_t minTriangles = 64;
+
+    mesh.lods.clear();
+    std::vector<GLuint> level = mesh.indices;
+    mesh.lods.push_back(MeshLod{0, static_cast<GLuint>(level.size()), 0.0f});
+
+    float accumulatedError = 0.0f;
+    while (mesh.lods.size() < maxLevels && level.size() / 3 > minTriangles) {
+        float error = 0.0f;
+        std::vector<GLuint> next = simplify(mesh, level, level.size() / 2, error);
+
+        // stop once the simplifier cannot make meaningful progress
+        if (next.empty() || next.size() > level.size() * 9 / 10) break;
+
+        accumulatedError += error;
+        mesh.lods.push_back(MeshLod{static_cast<GLuint>(mesh.indices.size()), static_cast<GLuint>(next.size()), accumulatedError});
+        mesh.indices.insert(mesh.indices.end(), next.begin(), next.end());
+        level = std::move(next);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "mesh.h"
+
+class MeshSimplifier {
+public:
+    // Simplify the triangles in `indices` (which index mesh.vertices) with quadric error
+    // metric edge collapses until at most targetIndexCount indices remain or no collapse is
+    // possible without flipping a triangle. Vertices are never moved, so the result indexes
+    // the same vertex buffer. Collapses see vertices at the same position as one, but each
+    // corner keeps a vertex with its own normal; vertices on a normal seam are never moved.
+    // @param error  On return, the largest object-space distance error introduced.
+    static std::vector<GLuint> simplify(const MeshData &mesh, const std::vector<GLuint> &indices,
+                                        size_t targetIndexCount, float &error);
+
+    // Build a LOD chain in place: level 0 is the full mesh, each following level has about
+    // half the triangles of the previous one. All levels share mesh.vertices and are stored
+    // one after another in mesh.indices, described by mesh.lods.
+    static void buildLods(MeshData &mesh);
+};
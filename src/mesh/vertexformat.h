@@ -0,0 +1,76 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/gtx/transform.hpp>
+
+// Compact vertex layout shared by binary meshes and generated primitives, 12 bytes instead of 24:
+// a snorm16 position (x, y, z, pad) relative to a center and uniform scale, followed by the
+// normal packed as GL_INT_2_10_10_10_REV.
+struct CompactVertex {
+    int16_t position[4];
+    uint32_t normal;
+};
+static_assert(sizeof(CompactVertex) == 12, "CompactVertex must be tightly packed");
+
+namespace VertexFormat {
+
+inline int16_t packSnorm16(float v) {
+    return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Signed, normalized 10:10:10:2 with x in the low bits, as expected by GL_INT_2_10_10_10_REV.
+inline uint32_t packNormal(glm::vec3 n) {
+    auto pack10 = [](float v) {
+        return static_cast<uint32_t>(static_cast<int32_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 511.0f)) & 0x3FF);
+    };
+    return pack10(n.x) | (pack10(n.y) << 10) | (pack10(n.z) << 20);
+}
+
+// Packs one interleaved position/normal vertex, position = center + scale * snorm position.
+inline CompactVertex pack(const float *v, glm::vec3 center, float scale) {
+    CompactVertex result;
+    result.position[0] = packSnorm16((v[0] - center.x) / scale);
+    result.position[1] = packSnorm16((v[1] - center.y) / scale);
+    result.position[2] = packSnorm16((v[2] - center.z) / scale);
+    result.position[3] = 0;
+    result.normal = packNormal(glm::vec3(v[3], v[4], v[5]));
+    return result;
+}
+
+inline std::vector<CompactVertex> pack(const std::vector<float> &vertices, glm::vec3 center, float scale) {
+    std::vector<CompactVertex> result(vertices.size() / 6);
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = pack(&vertices[i * 6], center, scale);
+    }
+    return result;
+}
+
+// Smallest uniform scale that fits the bounds into the snorm range.
+// A uniform scale keeps the dequantization free of any effect on normals.
+inline float scaleFor(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+    glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+    return std::max({extent.x, extent.y, extent.z, 1e-20f});
+}
+
+// Maps snorm positions back to object space, applied on top of the model matrix.
+inline glm::mat4 dequantizeMatrix(glm::vec3 center, float scale) {
+    return glm::translate(center) * glm::scale(glm::vec3(scale));
+}
+
+// Vertex attribute layout of CompactVertex, for the currently bound VAO/VBO.
+inline void setCompactVertexAttributes() {
+    // Position
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<void*>(0));
+
+    // Normal
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, normal)));
+}
+
+}
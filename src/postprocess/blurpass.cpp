@@ -0,0 +1,152 @@
+#include "blurpass.h"
+
+#include <algorithm>
+#include <cmath>
+
+void BlurPass::initialize(GLuint program) {
+    m_program = program;
+    m_stepLocation = glGetUniformLocation(m_program, "texel_step");
+    m_numTapsLocation = glGetUniformLocation(m_program, "num_taps");
+    m_offsetsLocation = glGetUniformLocation(m_program, "offsets");
+    m_weightsLocation = glGetUniformLocation(m_program, "weights");
+
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "my_texture"), 0);
+    glUseProgram(0);
+}
+
+void BlurPass::initializeCompute(GLuint program) {
+    m_computeProgram = program;
+    m_computeDirectionLocation = glGetUniformLocation(m_computeProgram, "direction");
+    m_computeRadiusLocation = glGetUniformLocation(m_computeProgram, "radius");
+    m_computeWeightsLocation = glGetUniformLocation(m_computeProgram, "weights");
+
+    glUseProgram(m_computeProgram);
+    glUniform1i(glGetUniformLocation(m_computeProgram, "my_texture"), 0);
+    glUseProgram(0);
+}
+
+void BlurPass::destroy() {
+    glDeleteProgram(m_program);
+    m_program = 0;
+    if (m_computeProgram != 0) {
+        glDeleteProgram(m_computeProgram);
+        m_computeProgram = 0;
+    }
+}
+
+void BlurPass::computeKernel(int radius, std::vector<float> &kernel) {
+    radius = std::clamp(radius, 0, MaxRadius);
+    float sigma = std::max(radius * 0.5f, 0.5f);
+
+    kernel.resize(radius + 1);
+    float total = 0.0f;
+    for (int i = 0; i <= radius; i++) {
+        kernel[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+        total += i == 0 ? kernel[i] : 2.0f * kernel[i];
+    }
+    for (float &k : kernel) {
+        k /= total;
+    }
+}
+
+void BlurPass::computeTaps(int radius, std::vector<float> &offsets, std::vector<float> &weights) {
+    std::vector<float> kernel;
+    computeKernel(radius, kernel);
+    radius = static_cast<int>(kernel.size()) - 1;
+
+    offsets.assign(1, 0.0f);
+    weights.assign(1, kernel[0]);
+    // merge texels i and i + 1 into one fetch at their weighted center
+    for (int i = 1; i <= radius; i += 2) {
+        float w0 = kernel[i];
+        float w1 = i + 1 <= radius ? kernel[i + 1] : 0.0f;
+        weights.push_back(w0 + w1);
+        offsets.push_back((i * w0 + (i + 1) * w1) / (w0 + w1));
+    }
+}
+
+void BlurPass::pass(GLuint source, const RenderTarget &target, float stepX, float stepY,
+                    const std::vector<float> &offsets, const std::vector<float> &weights) {
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(0, 0, target.width, target.height);
+
+    glUniform2f(m_stepLocation, stepX, stepY);
+    glUniform1i(m_numTapsLocation, static_cast<GLint>(weights.size()));
+    glUniform1fv(m_offsetsLocation, static_cast<GLsizei>(offsets.size()), offsets.data());
+    glUniform1fv(m_weightsLocation, static_cast<GLsizei>(weights.size()), weights.data());
+
+    glBindTexture(GL_TEXTURE_2D, source);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void BlurPass::dispatch(GLuint source, const RenderTarget &target, bool horizontal, const std::vector<float> &kernel) {
+    glUniform2i(m_computeDirectionLocation, horizontal ? 1 : 0, horizontal ? 0 : 1);
+    glUniform1i(m_computeRadiusLocation, static_cast<GLint>(kernel.size()) - 1);
+    glUniform1fv(m_computeWeightsLocation, static_cast<GLsizei>(kernel.size()), kernel.data());
+
+    glBindTexture(GL_TEXTURE_2D, source);
+    glBindImageTexture(0, target.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    // one work group per GROUP_SIZE pixels of each row (or column)
+    int length = horizontal ? target.width : target.height;
+    int lines = horizontal ? target.height : target.width;
+    glDispatchCompute((length + ComputeGroupSize - 1) / ComputeGroupSize, lines, 1);
+
+    // the next pass samples what was just written
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+RenderTarget BlurPass::apply(GLuint source, int width, int height, int radius, bool allowDownsample,
+                            GLuint fullscreenVao, RenderTargetPool &pool, Backend backend) {
+    int level = 0;
+    if (allowDownsample) {
+        while (radius > (PyramidRadius << level) && level + 1 < MaxLevels &&
+               (width >> (level + 1)) > 0 && (height >> (level + 1)) > 0) {
+            level++;
+        }
+    }
+
+    glUseProgram(m_program);
+    glBindVertexArray(fullscreenVao);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Each downsample is a single bilinear fetch between four source texels
+    std::vector<float> offsets, weights;
+    computeTaps(0, offsets, weights);
+    GLuint current = source;
+    RenderTarget downsampled;
+    for (int l = 1; l <= level; l++) {
+        RenderTarget next = pool.acquire(width >> l, height >> l);
+        pass(current, next, 0.0f, 0.0f, offsets, weights);
+        pool.release(downsampled);
+        downsampled = next;
+        current = next.texture;
+    }
+
+    int levelWidth = width >> level;
+    int levelHeight = height >> level;
+    int scaledRadius = (radius + (1 << level) - 1) >> level;
+    RenderTarget horizontal = pool.acquire(levelWidth, levelHeight);
+    RenderTarget vertical = pool.acquire(levelWidth, levelHeight);
+
+    if (backend == Backend::Compute && supportsCompute()) {
+        std::vector<float> kernel;
+        computeKernel(scaledRadius, kernel);
+        glUseProgram(m_computeProgram);
+        dispatch(current, horizontal, true, kernel);
+        dispatch(horizontal.texture, vertical, false, kernel);
+    }
+    else {
+        computeTaps(scaledRadius, offsets, weights);
+        pass(current, horizontal, 1.0f / levelWidth, 0.0f, offsets, weights);
+        pass(horizontal.texture, vertical, 0.0f, 1.0f / levelHeight, offsets, weights);
+    }
+    pool.release(downsampled);
+    pool.release(horizontal);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    return vertical;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "rendertargetpool.h"
+
+#include <vector>
+
+// Separable Gaussian blur run as a horizontal and a vertical pass of blur.frag, or of blur.comp
+// when the context supports compute shaders. Large radii are blurred on a downsampled copy of the
+// source (a 2x2 box per level), so the number of fetches per pixel stays bounded no matter how
+// wide the blur is.
+class BlurPass {
+public:
+    enum class Backend { Fragment, Compute };
+
+    static constexpr int MaxTaps = 32;                    // Must match MAX_TAPS in blur.frag
+    static constexpr int MaxRadius = 2 * (MaxTaps - 1);   // Widest kernel a single pass supports
+    static constexpr int PyramidRadius = 8;               // Largest radius blurred at a level before going down one
+    static constexpr int MaxLevels = 5;
+    static constexpr int ComputeGroupSize = 256;          // Must match GROUP_SIZE in blur.comp
+
+    // Takes ownership of program, which must be texture.vert + blur.frag.
+    void initialize(GLuint program);
+
+    // Optional, takes ownership of program, which must be blur.comp. Requires OpenGL 4.3.
+    void initializeCompute(GLuint program);
+    bool supportsCompute() const { return m_computeProgram != 0; }
+
+    // Blurs the width x height source with a kernel of the given radius in source pixels.
+    // Returns a target from pool holding the result, which the caller releases; it may be
+    // smaller than the source if it was downsampled. Leaves the viewport and framebuffer binding changed.
+    // The compute backend falls back to the fragment one if it isn't supported.
+    RenderTarget apply(GLuint source, int width, int height, int radius, bool allowDownsample,
+                       GLuint fullscreenVao, RenderTargetPool &pool, Backend backend = Backend::Fragment);
+
+    void destroy();
+
+    // Normalized Gaussian with sigma = radius / 2, kernel[i] applies at offsets -i and +i.
+    static void computeKernel(int radius, std::vector<float> &kernel);
+
+    // The kernel with neighbouring texels merged into bilinear taps, see blur.frag.
+    static void computeTaps(int radius, std::vector<float> &offsets, std::vector<float> &weights);
+
+private:
+    void pass(GLuint source, const RenderTarget &target, float stepX, float stepY,
+              const std::vector<float> &offsets, const std::vector<float> &weights);
+    void dispatch(GLuint source, const RenderTarget &target, bool horizontal, const std::vector<float> &kernel);
+
+    GLuint m_program = 0;
+    GLint m_stepLocation = -1;
+    GLint m_numTapsLocation = -1;
+    GLint m_offsetsLocation = -1;
+    GLint m_weightsLocation = -1;
+
+    GLuint m_computeProgram = 0;
+    GLint m_computeDirectionLocation = -1;
+    GLint m_computeRadiusLocation = -1;
+    GLint m_computeWeightsLocation = -1;
+};
@@ -0,0 +1,193 @@
+#include "postprocessor.h"
+#include "utils/shaderloader.h"
+
+#include <iostream>
+
+void PostProcessor::initialize(const std::string &vertexPath, const std::string &fragmentPath,
+                               const std::string &blurFragmentPath, const std::string &blurComputePath, GLuint fullscreenVao) {
+    m_programs.add("postprocess", vertexPath, fragmentPath);
+    m_vertexPath = vertexPath;
+    m_blurFragmentPath = blurFragmentPath;
+    m_blurComputePath = blurComputePath;
+    m_fullscreenVao = fullscreenVao;
+    initializeBlur();
+    if (!GLEW_VERSION_4_3) {
+        std::cout << "Compute shaders need OpenGL 4.3, post-processing stays on the fragment path" << std::endl;
+    }
+
+    // an empty chain is a single copy to the output
+    m_chain.clear();
+    m_passes.assign(1, Pass());
+    m_passes[0].program = program(m_passes[0]);
+}
+
+void PostProcessor::initializeBlur() {
+    m_blur.initialize(ShaderLoader::createShaderProgram(m_vertexPath.c_str(), m_blurFragmentPath.c_str()));
+    if (GLEW_VERSION_4_3) {
+        m_blur.initializeCompute(ShaderLoader::createComputeProgram(m_blurComputePath.c_str()));
+    }
+}
+
+void PostProcessor::reload() {
+    m_programs.destroy();
+    m_blur.destroy();
+    initializeBlur();
+    for (Pass &pass : m_passes) {
+        if (pass.stage != Stage::Blur) {
+            pass.program = program(pass);
+        }
+    }
+}
+
+GLuint PostProcessor::program(const Pass &pass) {
+    std::string defines;
+    if (pass.stage == Stage::Sharpen) {
+        defines += ShaderPermutations::define("STAGE_SHARPEN");
+    }
+    else if (pass.stage == Stage::Fxaa) {
+        defines += ShaderPermutations::define("STAGE_FXAA");
+    }
+    if (!pass.ops.empty()) {
+        defines += "#define POST_OPS(c)";
+        for (const PostNode &op : pass.ops) {
+            switch (op.filter) {
+            case PostFilter::Invert:    defines += " c = invert(c);"; break;
+            case PostFilter::Grayscale: defines += " c = grayscale(c);"; break;
+            case PostFilter::ToneMap:   defines += " c = tonemap(c);"; break;
+            default: break;
+            }
+        }
+        defines += "\n";
+    }
+
+    GLuint program = m_programs.get("postprocess", defines);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "my_texture"), 0);
+    glUseProgram(0);
+    return program;
+}
+
+void PostProcessor::setChain(const std::vector<PostNode> &chain) {
+    if (chain == m_chain && !m_passes.empty()) {
+        return;
+    }
+    m_chain = chain;
+    m_passes.clear();
+
+    auto isCopy = [](const Pass &pass) { return pass.stage == Stage::Fetch && pass.ops.empty(); };
+
+    Pass current;
+    for (const PostNode &node : chain) {
+        switch (node.filter) {
+        case PostFilter::Invert:
+        case PostFilter::Grayscale:
+        case PostFilter::ToneMap:
+            current.ops.push_back(node);
+            break;
+        case PostFilter::Sharpen:
+        case PostFilter::Fxaa:
+            if (!isCopy(current)) {
+                m_passes.push_back(current);
+            }
+            current = Pass();
+            current.stage = node.filter == PostFilter::Sharpen ? Stage::Sharpen : Stage::Fxaa;
+            current.amount = node.amount;
+            break;
+        case PostFilter::Blur:
+            if (node.amount <= 0.0f) {
+                break;
+            }
+            if (!isCopy(current)) {
+                m_passes.push_back(current);
+            }
+            current = Pass();
+            current.stage = Stage::Blur;
+            current.amount = node.amount;
+            m_passes.push_back(current);
+            current = Pass();
+            break;
+        }
+    }
+    // the last pass draws into the output, it also does the upsampling after a downsampled blur
+    m_passes.push_back(current);
+
+    for (Pass &pass : m_passes) {
+        if (pass.stage != Stage::Blur) {
+            pass.program = program(pass);
+        }
+    }
+    std::cout << "Post-processing: " << chain.size() << " filters in " << m_passes.size() << " passes" << std::endl;
+}
+
+void PostProcessor::render(GLuint source, int width, int height, GLuint outputFbo, int outputWidth, int outputHeight) {
+    glDisable(GL_DEPTH_TEST);
+
+    GLuint current = source;
+    int currentWidth = width;
+    int currentHeight = height;
+    RenderTarget held; // owns `current` unless it is the source
+
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        const Pass &pass = m_passes[i];
+
+        if (pass.stage == Stage::Blur) {
+            RenderTarget blurred = m_blur.apply(current, currentWidth, currentHeight, static_cast<int>(pass.amount),
+                                                true, m_fullscreenVao, m_pool, m_backend);
+            m_pool.release(held);
+            held = blurred;
+            current = blurred.texture;
+            currentWidth = blurred.width;
+            currentHeight = blurred.height;
+            continue;
+        }
+
+        bool last = i + 1 == m_passes.size();
+        RenderTarget output;
+        if (last) {
+            glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
+            glViewport(0, 0, outputWidth, outputHeight);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+        else {
+            output = m_pool.acquire(width, height);
+            glBindFramebuffer(GL_FRAMEBUFFER, output.fbo);
+            glViewport(0, 0, width, height);
+        }
+
+        glUseProgram(pass.program);
+        glUniform2f(glGetUniformLocation(pass.program, "texel_size"), 1.0f / currentWidth, 1.0f / currentHeight);
+        if (pass.stage == Stage::Sharpen) {
+            glUniform1f(glGetUniformLocation(pass.program, "sharpen_amount"), pass.amount);
+        }
+        for (const PostNode &op : pass.ops) {
+            if (op.filter == PostFilter::ToneMap) {
+                glUniform1f(glGetUniformLocation(pass.program, "exposure"), op.amount);
+            }
+        }
+
+        glBindVertexArray(m_fullscreenVao);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, current);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        // the input has been consumed, so its target can be the next pass's output
+        m_pool.release(held);
+        held = output;
+        current = output.texture;
+        currentWidth = width;
+        currentHeight = height;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void PostProcessor::destroy() {
+    m_pool.clear();
+    m_programs.destroy();
+    m_passes.clear();
+    m_chain.clear();
+    m_blur.destroy();
+}
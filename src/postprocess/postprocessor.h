@@ -0,0 +1,86 @@
+#pragma once
+
+#include "blurpass.h"
+#include "rendertargetpool.h"
+#include "utils/shaderpermutations.h"
+
+#include <string>
+#include <vector>
+
+enum class PostFilter {
+    // Per-pixel: only look at their own pixel, so any run of them is fused into one pass
+    Invert,
+    Grayscale,
+    ToneMap,   // amount is the exposure
+    // Neighbourhood: read around their pixel, so they start a new pass
+    Sharpen,   // amount is the strength
+    Fxaa,
+    Blur       // amount is the radius in pixels
+};
+
+struct PostNode {
+    PostFilter filter;
+    float amount = 1.0f;
+
+    bool operator==(const PostNode &other) const { return filter == other.filter && amount == other.amount; }
+};
+
+// Runs a chain of post-processing filters over a texture and draws the result into a framebuffer.
+// The chain is compiled into as few passes as possible: per-pixel filters are fused into the pass
+// before them (or into the final pass), and every pass renders into a target recycled from a pool,
+// so a chain of any length ping-pongs between two full resolution targets.
+class PostProcessor {
+public:
+    // Paths of texture.vert, postprocess.frag, blur.frag and blur.comp. Requires a current context.
+    // The compute shader is only loaded if the context supports OpenGL 4.3.
+    void initialize(const std::string &vertexPath, const std::string &fragmentPath,
+                    const std::string &blurFragmentPath, const std::string &blurComputePath, GLuint fullscreenVao);
+
+    // Optional, call before initialize() to load the pass programs from an on-disk binary cache.
+    void setBinaryCache(ProgramBinaryCache *cache) { m_programs.setBinaryCache(cache); }
+
+    // Backend used by convolution filters, the fragment path is the fallback if compute isn't supported.
+    void setBackend(BlurPass::Backend backend) { m_backend = backend; }
+
+    // Recompiles the passes if chain differs from the current one.
+    void setChain(const std::vector<PostNode> &chain);
+
+    // Rebuilds every program from the current shader sources, e.g. after a shader file was edited.
+    // Throws std::runtime_error if one fails to compile.
+    void reload();
+
+    // Runs the chain on the width x height source and draws the result into outputFbo.
+    void render(GLuint source, int width, int height, GLuint outputFbo, int outputWidth, int outputHeight);
+
+    void destroy();
+
+    size_t passCount() const { return m_passes.size(); }
+    BlurPass &blur() { return m_blur; }
+    RenderTargetPool &pool() { return m_pool; }
+
+private:
+    enum class Stage { Fetch, Sharpen, Fxaa, Blur };
+
+    struct Pass {
+        Stage stage = Stage::Fetch;
+        float amount = 1.0f;
+        std::vector<PostNode> ops; // Per-pixel filters run on the stage's result, in order
+        GLuint program = 0;
+    };
+
+    GLuint program(const Pass &pass);
+    void initializeBlur();
+
+    std::string m_vertexPath;
+    std::string m_blurFragmentPath;
+    std::string m_blurComputePath;
+    GLuint m_fullscreenVao = 0;
+    BlurPass::Backend m_backend = BlurPass::Backend::Fragment;
+
+    std::vector<PostNode> m_chain;
+    std::vector<Pass> m_passes;
+    ShaderPermutations m_programs; // Pass programs, by stage and fused filters
+
+    BlurPass m_blur;
+    RenderTargetPool m_pool;
+};
@@ -0,0 +1,48 @@
+#include "rendertargetpool.h"
+
+RenderTarget RenderTargetPool::acquire(int width, int height) {
+    for (size_t i = 0; i < m_free.size(); i++) {
+        if (m_free[i].width == width && m_free[i].height == height) {
+            RenderTarget target = m_free[i];
+            m_free.erase(m_free.begin() + i);
+            return target;
+        }
+    }
+
+    RenderTarget target;
+    target.width = width;
+    target.height = height;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // linear filtering lets passes merge taps and resample between sizes
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_allocated++;
+    return target;
+}
+
+void RenderTargetPool::release(const RenderTarget &target) {
+    if (target.fbo != 0) {
+        m_free.push_back(target);
+    }
+}
+
+void RenderTargetPool::clear() {
+    for (RenderTarget &target : m_free) {
+        glDeleteFramebuffers(1, &target.fbo);
+        glDeleteTextures(1, &target.texture);
+    }
+    m_allocated -= m_free.size();
+    m_free.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <vector>
+
+// A color-only render target: an RGBA8 texture attached to its own FBO.
+struct RenderTarget {
+    GLuint fbo = 0;
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Hands out render targets and takes them back for reuse, so a chain of passes only ever
+// allocates as many targets of each size as it has alive at the same time.
+class RenderTargetPool {
+public:
+    // A free target of exactly width x height, allocated if there is none. Requires a current context.
+    RenderTarget acquire(int width, int height);
+
+    // Makes target available to the next acquire. It must not be used after this.
+    void release(const RenderTarget &target);
+
+    // Deletes every free target, e.g. after the resolution changed. Requires a current context.
+    void clear();
+
+    // Number of targets currently allocated, in use or free.
+    size_t allocated() const { return m_allocated; }
+
+private:
+    std::vector<RenderTarget> m_free;
+    size_t m_allocated = 0;
+};
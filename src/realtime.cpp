@@ -1,12 +1,17 @@
 #include "realtime.h"
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QStandardPaths>
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include "settings.h"
 #include "./shape.cpp"
 #include "./utils/shaderloader.h"
+#include "./utils/gputimer.h"
 
 bool firstRun = true;
 
@@ -23,6 +28,11 @@ void printVec4(const glm::vec4& vector) {
     std::cout << "(" << vector.x << ", " << vector.y << ", " << vector.z << ", " << vector.w << ")" << std::endl;
 }
 
+// shaders are compiled in as Qt resources, so nothing is read from disk unless --shader-dir overrides them
+std::string shaderPath(const char *name) {
+    return std::string(ShaderLoader::ResourcePrefix) + name;
+}
+
 // ================== Project 5: Lights, Camera
 
 Realtime::Realtime(QWidget *parent)
@@ -32,13 +42,6 @@ Realtime::Realtime(QWidget *parent)
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
 
-    m_keyMap[Qt::Key_W]       = false;
-    m_keyMap[Qt::Key_A]       = false;
-    m_keyMap[Qt::Key_S]       = false;
-    m_keyMap[Qt::Key_D]       = false;
-    m_keyMap[Qt::Key_Control] = false;
-    m_keyMap[Qt::Key_Space]   = false;
-
     // If you must use this function, do not edit anything above this
 }
 
@@ -47,32 +50,44 @@ void Realtime::finish() {
     this->makeCurrent();
 
     // Students: anything requiring OpenGL calls when the program exits should be done here
+    m_permutations.destroy();
+
     // Delete all vao & vbo
     glDeleteBuffers(1, &m_fullscreen_vbo);
     glDeleteVertexArrays(1, &m_fullscreen_vao);
 
     glDeleteBuffers(1, &vbo_cube);
+    glDeleteBuffers(1, &ebo_cube);
     glDeleteVertexArrays(1, &vao_cube);
 
     glDeleteBuffers(1, &vbo_sphere);
+    glDeleteBuffers(1, &ebo_sphere);
     glDeleteVertexArrays(1, &vao_sphere);
 
     glDeleteBuffers(1, &vbo_cyl);
+    glDeleteBuffers(1, &ebo_cyl);
     glDeleteVertexArrays(1, &vao_cyl);
 
     glDeleteBuffers(1, &vbo_cone);
+    glDeleteBuffers(1, &ebo_cone);
     glDeleteVertexArrays(1, &vao_cone);
 
+    m_meshCache.clear();
+    m_postProcessor.destroy();
+    m_frameTimer.destroy();
+
     // Delete FBO, RBO and associated textures
-    glDeleteTextures(1, &m_fbo_texture);
-    glDeleteRenderbuffers(1, &m_fbo_renderbuffer);
-    glDeleteFramebuffers(1, &m_fbo);
+    m_renderTargets.destroy();
+    m_gbuffer.destroy();
+    m_shadowAtlas.destroy();
+    m_pointShadows.destroy();
+    m_lightCulling.destroy();
 
     this->doneCurrent();
 }
 
 void Realtime::initializeGL() {
-    m_devicePixelRatio = this->devicePixelRatio();
+    m_startupTimer.start();
 
     m_timer = startTimer(1000/60);
     m_elapsedTimer.start();
@@ -85,33 +100,54 @@ void Realtime::initializeGL() {
         std::cerr << "Error while initializing GL: " << glewGetErrorString(err) << std::endl;
     }
     std::cout << "Initialized GL: Version " << glewGetString(GLEW_VERSION) << std::endl;
+    m_clipControl = GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+    updateDepthMode();
 
     // Allows OpenGL to draw objects appropriately on top of one another
     glEnable(GL_DEPTH_TEST);
     // Tells OpenGL to only draw the front face
     glEnable(GL_CULL_FACE);
-    // Tells OpenGL how big the screen is
-    glViewport(0, 0, size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
-
-    m_screen_width = reinterpret_cast<int>(size().width() * m_devicePixelRatio);
-    m_screen_height = reinterpret_cast<int>(size().height() * m_devicePixelRatio);
-    m_fbo_width = m_screen_width;
-    m_fbo_height = m_screen_height;
+    // Tells the render targets how big the screen is, in physical pixels
+    m_renderTargets.resize(size().width(), size().height(), devicePixelRatio());
 
 
     // Students: anything requiring OpenGL calls when the program starts should be done here
-    m_shader = ShaderLoader::createShaderProgram("/Users/leoxu/Brown/CS1230/projects-realtime-lebretou/resources/shaders/default.vert",
-                                                 "/Users/leoxu/Brown/CS1230/projects-realtime-lebretou/resources/shaders/default.frag");
+    // linked programs are kept between runs, --clear-shader-cache measures a cold start
+    m_programCache.initialize(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString() + "/shaders");
+    if (QCoreApplication::arguments().contains("--clear-shader-cache")) {
+        m_programCache.clear();
+    }
+    m_permutations.setBinaryCache(&m_programCache);
+    m_postProcessor.setBinaryCache(&m_programCache);
+
+    // --shader-dir <directory> reads shaders from there instead, and reloads them on every edit
+    QStringList arguments = QCoreApplication::arguments();
+    int shaderDirIndex = arguments.indexOf("--shader-dir");
+    if (shaderDirIndex >= 0 && shaderDirIndex + 1 < static_cast<int>(arguments.size())) {
+        watchShaderDirectory(arguments.at(shaderDirIndex + 1));
+    }
 
-    m_texture_shader = ShaderLoader::createShaderProgram("/Users/leoxu/Brown/CS1230/projects-realtime-lebretou/resources/shaders/texture.vert",
-                                                 "/Users/leoxu/Brown/CS1230/projects-realtime-lebretou/resources/shaders/texture.frag");
+    // scene programs are specialized per light mix and feature, see ShaderPermutations
+    m_permutations.add("phong", shaderPath("default.vert"), shaderPath("default.frag"));
+    m_permutations.add("depth", shaderPath("default.vert"), shaderPath("depth.frag"));
+    m_permutations.add("gbuffer", shaderPath("default.vert"), shaderPath("gbuffer.frag"));
+    m_permutations.add("deferred", shaderPath("texture.vert"), shaderPath("default.frag"));
+    m_permutations.add("fallback", shaderPath("default.vert"), shaderPath("fallback.frag"));
+    m_permutations.add("pointshadow", shaderPath("pointshadow.vert"), shaderPath("pointshadow.geom"),
+                       shaderPath("pointshadow.frag"));
+
+    // issue every compile before waiting on any, the driver works on them while the first frames draw with the fallback
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    m_permutations.request("depth");
+    updateLightPermutation();
 
     firstRun = false;
 
-     glUseProgram(m_texture_shader);
-     glUniform1i(glGetUniformLocation(m_texture_shader, "my_texture"), 0);
-     glUseProgram(0);
-
     std::vector<GLfloat> fullscreen_quad_data =
         { //     POSITIONS    //
             -1.0f,  1.0f, 0.0f,
@@ -146,40 +182,169 @@ void Realtime::initializeGL() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    makeFBO();
+    m_renderTargets.update();
+    m_frameTimer.initialize();
+    m_statsTimer.start();
 
+    m_postProcessor.initialize(shaderPath("texture.vert"), shaderPath("postprocess.frag"),
+                               shaderPath("blur.frag"), shaderPath("blur.comp"), m_fullscreen_vao);
 
+    // run once with --clear-shader-cache and once without to compare a cold and a warm cache
+    std::cout << "Startup: initializeGL took " << m_startupTimer.elapsed() << " ms, " << m_programCache.hits()
+              << " programs loaded from the binary cache, " << m_programCache.misses() << " compiled" << std::endl;
+
+    if (QCoreApplication::arguments().contains("--benchmark")) {
+        benchmarkBlur();
+    }
 }
 
 void Realtime::paintGL() {
     // Students: anything requiring OpenGL calls every frame should be done here
+    // Reallocate the scene buffer once a resize has settled; old post-processing targets are the wrong size
+    m_renderTargets.setSamples(settings.msaaSamples);
+    m_renderTargets.setFloatDepth(m_reversedZ);
+    if (m_renderTargets.update()) {
+        m_postProcessor.pool().clear();
+    }
+    m_frameTimer.begin();
+
+    // the camera moves in fixed steps however long the frame took, and is drawn between the last two
+    glm::vec3 forward = glm::normalize(glm::vec3(curRenderData.cameraData.look));
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::normalize(glm::vec3(curRenderData.cameraData.up))));
+    m_camera.advance(m_elapsedTimer.nsecsElapsed() * 1e-9, forward, right);
+    m_elapsedTimer.restart();
+    m_cameraPosition = m_camera.position();
+    if (m_camera.moving()) {
+        curRenderData.cameraData.pos = glm::vec4(glm::vec3(m_cameraPosition), 1.0f);
+        curRenderData.cameraData.updateView();
+        curView = curRenderData.cameraData.view;
+    }
+
+    if (m_shadersChanged) {
+        m_shadersChanged = false;
+        reloadShaders();
+    }
+
+    // large-world mode moves the origin to the camera every frame, everything uploaded is relative to it
+    // in double straight from the simulation, the float copy is centimeters off kilometers out
+    m_worldOrigin = settings.largeWorld ? m_cameraPosition : glm::dvec3(0.0);
+
+    // pick up the programs that finished compiling since the last frame, a broken one leaves its fallback in place
+    try {
+        m_permutations.poll();
+    }
+    catch (const std::runtime_error &e) {
+        std::cout << "shader program failed to build:\n" << e.what() << std::endl;
+    }
+
+    if (settings.shadows) {
+        renderShadowMaps();
+    }
+    else {
+        m_shadowAtlas.destroy();
+        m_pointShadows.destroy();
+    }
+
+    if (settings.lightCulling) {
+        m_lightCulling.cullTiles(curView, curProj, settings.nearPlane,
+                                 m_renderTargets.internalWidth(), m_renderTargets.internalHeight());
+    }
+    else {
+        m_lightCulling.destroy();
+    }
+
+    beginSceneDepth();
+
     // Bind our FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_renderTargets.sceneFbo());
 
     // Call glViewport
-    glViewport(0, 0, m_fbo_width, m_fbo_height);
+    glViewport(0, 0, m_renderTargets.internalWidth(), m_renderTargets.internalHeight());
 
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    drawShapes();
+    // forward shading draws until the deferred programs have compiled
+    if (!settings.deferredShading || !drawShapesDeferred()) {
+        if (!settings.deferredShading) {
+            // the G-buffer is large, don't hold on to it while it isn't used
+            m_gbuffer.destroy();
+        }
+        drawShapes();
+    }
+    endSceneDepth();
+    m_renderTargets.resolve();
+
+    // run the filters and draw the result into the default buffer
+    m_postProcessor.setChain(postProcessChain());
+    m_postProcessor.setBackend(settings.computePostProcessing ? BlurPass::Backend::Compute : BlurPass::Backend::Fragment);
+    m_postProcessor.render(m_renderTargets.sceneTexture(), m_renderTargets.internalWidth(), m_renderTargets.internalHeight(),
+                           defaultFramebufferObject(), m_renderTargets.outputWidth(), m_renderTargets.outputHeight());
+
+    m_frameTimer.end();
+    updateResolutionScale();
+    printFrameStats();
+
+    if (m_firstFrame) {
+        m_firstFrame = false;
+        std::cout << "Startup: first frame after " << m_startupTimer.elapsed() << " ms" << std::endl;
+    }
+    if (!m_programsReady && !m_permutations.pending()) {
+        m_programsReady = true;
+        std::cout << "Startup: all shader programs ready after " << m_startupTimer.elapsed() << " ms" << std::endl;
+    }
+}
 
-    // bind the default buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, m_defaultFBO);
-    glViewport(0, 0, m_screen_width, m_screen_height);
+void Realtime::updateResolutionScale() {
+    if (!settings.dynamicResolution) {
+        m_dynamicResolution.reset();
+        m_renderTargets.setScale(1.0f);
+        m_frameTimer.collect();
+        return;
+    }
+    // results arrive a few frames late, so this reacts to frames rendered at a slightly older scale
+    if (m_frameTimer.collect()) {
+        m_renderTargets.setScale(m_dynamicResolution.update(m_frameTimer.latest(), settings.targetFrameTime));
+    }
+}
 
-    // Task 26: Clear the color and depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Realtime::printFrameStats() {
+    if (!settings.dynamicResolution || m_statsTimer.elapsed() < 1000 || m_frameTimer.history().empty()) {
+        return;
+    }
+    m_statsTimer.restart();
 
-    paintTexture(m_fbo_texture, settings.perPixelFilter, settings.kernelBasedFilter);
+    std::cout << "Frame: " << m_frameTimer.latest() << " ms GPU (avg " << m_frameTimer.average()
+              << ", worst " << m_frameTimer.worst() << " over " << m_frameTimer.history().size() << " frames, target "
+              << settings.targetFrameTime << "), scale " << m_renderTargets.scale() << " -> "
+              << m_renderTargets.internalWidth() << "x" << m_renderTargets.internalHeight() << std::endl;
+}
 
+std::vector<PostNode> Realtime::postProcessChain() {
+    std::vector<PostNode> chain;
+    if (settings.toneMapFilter) {
+        chain.push_back(PostNode{PostFilter::ToneMap, 1.0f});
+    }
+    if (settings.fxaaFilter) {
+        chain.push_back(PostNode{PostFilter::Fxaa});
+    }
+    if (settings.sharpenFilter) {
+        chain.push_back(PostNode{PostFilter::Sharpen, 0.5f});
+    }
+    if (settings.kernelBasedFilter) {
+        // the radius is in output pixels, the chain runs at the internal resolution
+        float radius = std::max(1.0f, std::round(settings.blurRadius * m_renderTargets.scale()));
+        chain.push_back(PostNode{PostFilter::Blur, radius});
+    }
+    if (settings.perPixelFilter) {
+        chain.push_back(PostNode{PostFilter::Invert});
+    }
+    return chain;
 }
 
 void Realtime::resizeGL(int w, int h) {
-    // Tells OpenGL how big the screen is
-    glViewport(0, 0, size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
-
-    // Students: anything requiring OpenGL calls when the program starts should be done here
+    // w and h are in device-independent pixels, the scene buffer follows once the size settles
+    m_renderTargets.resize(w, h, devicePixelRatio());
 }
 
 void Realtime::sceneChanged() {
@@ -191,11 +356,19 @@ void Realtime::sceneChanged() {
 
     // assign the current view matrix
     curView = curRenderData.cameraData.view;
+    m_camera.reset(glm::dvec3(curRenderData.cameraData.pos));
+    m_cameraPosition = m_camera.position();
 
     // update the camera data and proj matrix using the new settings
     updateCamera(settings.nearPlane, settings.farPlane);
 
+    makeCurrent();
     updateVAOVBO();
+    updateLightPermutation();
+
+    if (QCoreApplication::arguments().contains("--benchmark")) {
+        benchmarkAntialiasing();
+    }
 
     update(); // asks for a PaintGL() call to occur
 }
@@ -208,12 +381,25 @@ void Realtime::settingsChanged() {
         oldFar = settings.farPlane;
     }
     else {
-        // we won't update the vao or vbo on the first run since no data
-        if (!firstRun) {
+        // we won't update the vao or vbo on the first run since no data, and of the other settings
+        // only the tessellation and the vertex format change the primitives
+        bool primitivesChanged = settings.shapeParameter1 != m_primitiveParam1 ||
+                                 settings.shapeParameter2 != m_primitiveParam2 ||
+                                 settings.compactVertices != m_primitiveCompact;
+        if (!firstRun && primitivesChanged) {
             updateVAOVBO();
         }
     }
 
+    if (!firstRun) {
+        // shadows, light culling and large-world mode change the shader variants, the shadow size the atlas layout
+        makeCurrent();
+        if (updateDepthMode()) {
+            updateCamera(settings.nearPlane, settings.farPlane);
+        }
+        updateLightPermutation();
+    }
+
     update(); // asks for a PaintGL() call to occur
 }
 
@@ -262,6 +448,11 @@ void Realtime::updateVAOVBO() {
                 d_cyl.insert(d_cyl.end(), cyl.m_vertexData.begin(), cyl.m_vertexData.end());
                 break;
             }
+            case PrimitiveType::PRIMITIVE_MESH: {
+                // loaded once per file, no matter how many primitives reference it
+                shape.mesh = m_meshCache.get(shape.primitive.meshfile);
+                break;
+            }
 
             default: {
                 break;
@@ -270,128 +461,559 @@ void Realtime::updateVAOVBO() {
     }
 
 
-    setupShapeVAOVBO(vao_cube, vbo_cube, d_cube);
-    setupShapeVAOVBO(vao_sphere, vbo_sphere, d_sphere);
-    setupShapeVAOVBO(vao_cyl, vbo_cyl, d_cyl);
-    setupShapeVAOVBO(vao_cone, vbo_cone, d_cone);
+    m_primitiveDequantize = settings.compactVertices ? glm::scale(glm::vec3(Shape::CompactScale)) : glm::mat4(1.0f);
+    setupShapeVAOVBO(vao_cube, vbo_cube, ebo_cube, count_cube, d_cube, "cube");
+    setupShapeVAOVBO(vao_sphere, vbo_sphere, ebo_sphere, count_sphere, d_sphere, "sphere");
+    setupShapeVAOVBO(vao_cyl, vbo_cyl, ebo_cyl, count_cyl, d_cyl, "cylinder");
+    setupShapeVAOVBO(vao_cone, vbo_cone, ebo_cone, count_cone, d_cone, "cone");
+
+    // only meshes that are new to the cache get uploaded
+    m_meshCache.upload(&Realtime::setVertexAttributes, settings.compactVertices);
+
+    m_primitiveParam1 = settings.shapeParameter1;
+    m_primitiveParam2 = settings.shapeParameter2;
+    m_primitiveCompact = settings.compactVertices;
 
+    // the cached shadow depth was rendered from the old geometry
+    m_shadowAtlas.invalidate();
+    m_pointShadows.invalidate();
 }
 
 
-void Realtime::drawShapes() {
-    glUseProgram(m_shader);
+void Realtime::setupShapeVAOVBO(GLuint& vao, GLuint& vbo, GLuint& ebo, GLsizei& indexCount,
+                                const std::vector<float>& vertexData, const std::string& name) {
+    // the objects of the previous tessellation, deleting 0 is ignored
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+    indexCount = 0;
+    if (!vertexData.empty()) {
+        // Index the generated triangles and reorder them for the vertex cache before uploading
+        MeshData mesh = MeshOptimizer::indexVertices(vertexData);
+        MeshOptimizer::optimize(mesh, name);
+        indexCount = static_cast<GLsizei>(mesh.indices.size());
+
+        // Generate and set up the VAO
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+
+        // Generate and bind the VBO, in the compact or the float layout
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (settings.compactVertices) {
+            std::vector<CompactVertex> vertices = VertexFormat::pack(mesh.vertices, glm::vec3(0.0f), Shape::CompactScale);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactVertex), vertices.data(), GL_STATIC_DRAW);
+            VertexFormat::setCompactVertexAttributes();
+        }
+        else {
+            glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(GLfloat), mesh.vertices.data(), GL_STATIC_DRAW);
+            setVertexAttributes();
+        }
+
+        // The element buffer binding is stored in the VAO
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+
+        // Unbind the VAO before the buffers, so it keeps its element buffer
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
+
+bool Realtime::drawShapesDeferred() {
+    std::string deferredDefines = m_lightDefines + ShaderPermutations::define("DEFERRED");
+    m_permutations.request("gbuffer", m_worldDefines);
+    m_permutations.request("deferred", deferredDefines);
+    GLuint gbufferShader = m_permutations.ready("gbuffer", m_worldDefines);
+    GLuint deferredShader = m_permutations.ready("deferred", deferredDefines);
+    if (gbufferShader == 0 || deferredShader == 0) {
+        return false;
+    }
+
+    updateDrawOrder();
+
+    // geometry pass: the surface of the nearest shape at each pixel
+    m_gbuffer.resize(m_renderTargets.internalWidth(), m_renderTargets.internalHeight(), m_reversedZ);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gbuffer.fbo());
+    glViewport(0, 0, m_gbuffer.width(), m_gbuffer.height());
+    // position.w stays 0 where nothing is drawn, which the lighting pass treats as background
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(gbufferShader);
+    GLsizei count = 0;
+    for (size_t index : m_drawOrder) {
+        const RenderShapeData &shape = curRenderData.shapes[index];
+        if (!bindShape(shape, count)) {
+            continue;
+        }
+        setShapeUniforms(gbufferShader, shape);
+        drawShape(shape, count);
+    }
+    glBindVertexArray(0);
+
+    // lighting pass: every covered pixel is lit once, with the same shader code as the forward path
+    glBindFramebuffer(GL_FRAMEBUFFER, m_renderTargets.sceneFbo());
+    glViewport(0, 0, m_renderTargets.internalWidth(), m_renderTargets.internalHeight());
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(deferredShader);
+    glUniform1i(glGetUniformLocation(deferredShader, "g_position"), GBuffer::Position);
+    glUniform1i(glGetUniformLocation(deferredShader, "g_normal"), GBuffer::Normal);
+    glUniform1i(glGetUniformLocation(deferredShader, "g_ambient"), GBuffer::Ambient);
+    glUniform1i(glGetUniformLocation(deferredShader, "g_diffuse"), GBuffer::Diffuse);
+    glUniform1i(glGetUniformLocation(deferredShader, "g_specular"), GBuffer::Specular);
+    setLightUniforms(deferredShader);
+    for (int i = 0; i < GBuffer::AttachmentCount; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, m_gbuffer.texture(static_cast<GBuffer::Attachment>(i)));
+    }
+    glBindVertexArray(m_fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    glBindVertexArray(0);
+    for (int i = GBuffer::AttachmentCount - 1; i >= 0; i--) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+    return true;
+}
+
+bool Realtime::bindShape(const RenderShapeData &shape, GLsizei &count) {
+    switch (shape.primitive.type) {
+    case PrimitiveType::PRIMITIVE_CUBE:
+        glBindVertexArray(vao_cube);
+        count = count_cube;
+        return true;
+    case PrimitiveType::PRIMITIVE_CONE:
+        glBindVertexArray(vao_cone);
+        count = count_cone;
+        return true;
+    case PrimitiveType::PRIMITIVE_CYLINDER:
+        glBindVertexArray(vao_cyl);
+        count = count_cyl;
+        return true;
+    case PrimitiveType::PRIMITIVE_SPHERE:
+        glBindVertexArray(vao_sphere);
+        count = count_sphere;
+        return true;
+    case PrimitiveType::PRIMITIVE_MESH:
+        if (shape.mesh == nullptr || !shape.mesh->uploaded) {
+            return false;
+        }
+        glBindVertexArray(shape.mesh->vao);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Realtime::drawShape(const RenderShapeData &shape, GLsizei count) {
+    if (shape.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
+        MeshLod lod = selectMeshLod(shape);
+        size_t indexSize = shape.mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+        glDrawElements(GL_TRIANGLES, lod.indexCount, shape.mesh->indexType,
+                       reinterpret_cast<void*>(lod.indexOffset * indexSize));
+    }
+    else {
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, reinterpret_cast<void*>(0));
+    }
+}
+
+void Realtime::updateDrawOrder() {
+    m_drawOrder.resize(curRenderData.shapes.size());
+    std::iota(m_drawOrder.begin(), m_drawOrder.end(), 0);
+    if (!settings.sortFrontToBack) {
+        return;
+    }
+
+    // by the distance of each shape's origin to the camera, close enough for depth testing to reject most of what is behind
+    glm::vec3 camera = glm::vec3(curRenderData.cameraData.pos);
+    m_drawDistances.resize(curRenderData.shapes.size());
+    for (size_t i = 0; i < curRenderData.shapes.size(); i++) {
+        glm::vec3 offset = glm::vec3(curRenderData.shapes[i].ctm[3]) - camera;
+        m_drawDistances[i] = glm::dot(offset, offset);
+    }
+    std::sort(m_drawOrder.begin(), m_drawOrder.end(),
+              [this](size_t a, size_t b) { return m_drawDistances[a] < m_drawDistances[b]; });
+}
+
+bool Realtime::drawDepthPrePass() {
+    GLuint depthShader = m_permutations.ready("depth", m_worldDefines);
+    if (depthShader == 0) {
+        return false;
+    }
+    glUseProgram(depthShader);
+    glUniformMatrix4fv(glGetUniformLocation(depthShader, "model_view"), 1, GL_FALSE, &curView[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(depthShader, "model_proj"), 1, GL_FALSE, &curProj[0][0]);
+    GLint modelLocation = glGetUniformLocation(depthShader, "model_matrix");
+    GLint modelViewLocation = glGetUniformLocation(depthShader, "model_view_matrix");
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    GLsizei count = 0;
+    for (size_t index : m_drawOrder) {
+        const RenderShapeData &shape = curRenderData.shapes[index];
+        if (!bindShape(shape, count)) {
+            continue;
+        }
+        // must match the color pass exactly, or GL_EQUAL rejects the fragments
+        glm::mat4 modelMatrix, modelView;
+        shapeMatrices(shape, modelMatrix, modelView);
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &modelMatrix[0][0]);
+        glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, &modelView[0][0]);
+        drawShape(shape, count);
+    }
+    glBindVertexArray(0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    return true;
+}
+
+void Realtime::renderShadowMaps() {
+    std::vector<glm::vec4> casters(curRenderData.shapes.size());
+    for (size_t i = 0; i < casters.size(); i++) {
+        casters[i] = shapeBounds(curRenderData.shapes[i]);
+    }
+    renderPointShadows(casters);
 
-    int size = 0;
+    GLuint depthShader = m_permutations.ready("depth");
+    m_shadowAtlas.fitCascades(curView, curProj, settings.nearPlane, settings.farPlane);
+    if (depthShader == 0 || !m_shadowAtlas.needsRendering()) {
+        return;
+    }
+    m_shadowAtlas.allocate();
+
+    glUseProgram(depthShader);
+    GLint viewLocation = glGetUniformLocation(depthShader, "model_view");
+    GLint projLocation = glGetUniformLocation(depthShader, "model_proj");
+    GLint modelLocation = glGetUniformLocation(depthShader, "model_matrix");
+    // slope-scaled bias on top of the normal offset in default.frag
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.5f, 4.0f);
+
+    const std::vector<ShadowAtlas::Tile> &tiles = m_shadowAtlas.tiles();
+    GLsizei count = 0;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (tiles[i].valid) {
+            continue;
+        }
+        m_shadowAtlas.beginTile(i);
+        glUniformMatrix4fv(viewLocation, 1, GL_FALSE, &tiles[i].view[0][0]);
+        glUniformMatrix4fv(projLocation, 1, GL_FALSE, &tiles[i].proj[0][0]);
+        for (const RenderShapeData &shape : curRenderData.shapes) {
+            if (!bindShape(shape, count)) {
+                continue;
+            }
+            glm::mat4 modelMatrix = shape.ctm * (shape.mesh ? shape.mesh->dequantize : m_primitiveDequantize);
+            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &modelMatrix[0][0]);
+            drawShape(shape, count);
+        }
+        m_shadowAtlas.endTile(i);
+    }
+
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glUseProgram(0);
+    m_shadowAtlas.end();
+}
+
+void Realtime::renderPointShadows(const std::vector<glm::vec4> &casters) {
+    m_pointShadows.updateCasters(casters);
+    m_pointShadows.updateImportance(glm::vec3(curRenderData.cameraData.pos));
+    if (!m_pointShadows.needsRendering()) {
+        return;
+    }
+    // built in the background like the scene programs, the cubes wait until it is ready
+    m_permutations.request("pointshadow");
+    GLuint program = m_permutations.ready("pointshadow");
+    if (program == 0) {
+        return;
+    }
+    m_pointShadows.setProgram(program);
+    m_pointShadows.allocate();
+
+    const std::vector<PointShadows::Light> &lights = m_pointShadows.lights();
+    GLsizei count = 0;
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (lights[i].tier < 0 || lights[i].dirtyFaces == 0) {
+            continue;
+        }
+        // one layered pass, each shape only goes to the dirty faces its bounds reach
+        m_pointShadows.beginLight(i);
+        for (size_t s = 0; s < curRenderData.shapes.size(); s++) {
+            const RenderShapeData &shape = curRenderData.shapes[s];
+            glm::mat4 modelMatrix = shape.ctm * (shape.mesh ? shape.mesh->dequantize : m_primitiveDequantize);
+            if (!m_pointShadows.setCaster(i, casters[s], modelMatrix) || !bindShape(shape, count)) {
+                continue;
+            }
+            drawShape(shape, count);
+        }
+        m_pointShadows.endLight(i);
+    }
+    glBindVertexArray(0);
+    m_pointShadows.end();
+}
+
+glm::vec4 Realtime::shapeBounds(const RenderShapeData &shape) {
+    // primitives fit in the unit cube around the origin
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = std::sqrt(3.0f) / 2.0f;
+    if (shape.primitive.type == PrimitiveType::PRIMITIVE_MESH && shape.mesh != nullptr) {
+        center = (shape.mesh->data.boundsMin + shape.mesh->data.boundsMax) * 0.5f;
+        radius = glm::length(shape.mesh->data.boundsMax - shape.mesh->data.boundsMin) * 0.5f;
+    }
+    float worldScale = std::max({glm::length(glm::vec3(shape.ctm[0])),
+                                 glm::length(glm::vec3(shape.ctm[1])),
+                                 glm::length(glm::vec3(shape.ctm[2]))});
+    return glm::vec4(glm::vec3(shape.ctm * glm::vec4(center, 1.0f)), radius * worldScale);
+}
+
+glm::vec4 Realtime::sceneBounds() {
+    if (curRenderData.shapes.empty()) {
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const RenderShapeData &shape : curRenderData.shapes) {
+        glm::vec4 bounds = shapeBounds(shape);
+        boundsMin = glm::min(boundsMin, glm::vec3(bounds) - bounds.w);
+        boundsMax = glm::max(boundsMax, glm::vec3(bounds) + bounds.w);
+    }
+    return glm::vec4((boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f);
+}
+
+void Realtime::updateLightPermutation() {
+    // default.frag loops over directional, then point, then spot lights
+    auto rank = [](LightType type) {
+        switch (type) {
+        case LightType::LIGHT_DIRECTIONAL: return 0;
+        case LightType::LIGHT_POINT:       return 1;
+        default:                           return 2;
+        }
+    };
+    const std::vector<SceneLightData> &lights = curRenderData.lights;
+    m_lightOrder.resize(lights.size());
+    std::iota(m_lightOrder.begin(), m_lightOrder.end(), 0);
+    std::stable_sort(m_lightOrder.begin(), m_lightOrder.end(),
+                     [&](size_t a, size_t b) { return rank(lights[a].type) < rank(lights[b].type); });
+    if (m_lightOrder.size() > MaxLights) {
+        std::cout << "Only the first " << MaxLights << " of " << m_lightOrder.size() << " lights are drawn" << std::endl;
+        m_lightOrder.resize(MaxLights);
+    }
+
+    int counts[3] = {0, 0, 0};
+    for (size_t index : m_lightOrder) {
+        counts[rank(lights[index].type)]++;
+    }
+    m_worldDefines = settings.largeWorld ? ShaderPermutations::define("CAMERA_RELATIVE") : "";
+    m_lightDefines = m_worldDefines
+                   + ShaderPermutations::define("NUM_DIRECTIONAL_LIGHTS", counts[0])
+                   + ShaderPermutations::define("NUM_POINT_LIGHTS", counts[1])
+                   + ShaderPermutations::define("NUM_SPOT_LIGHTS", counts[2]);
+    if (settings.shadows) {
+        m_lightDefines += ShaderPermutations::define("SHADOWS");
+        glm::vec4 bounds = sceneBounds();
+        m_shadowAtlas.setLights(lights, m_lightOrder, settings.shadowMapSize, glm::vec3(bounds), bounds.w);
+        m_pointShadows.setLights(lights, m_lightOrder, settings.shadowMapSize, glm::vec3(bounds), bounds.w);
+    }
+    if (settings.lightCulling) {
+        // shapes don't move, so their masks only change with the lights, the tiles follow the camera every frame
+        m_lightDefines += ShaderPermutations::define("LIGHT_CULLING");
+        m_lightCulling.setLights(lights, m_lightOrder, settings.lightCutoff);
+        std::vector<glm::vec4> bounds(curRenderData.shapes.size());
+        for (size_t i = 0; i < bounds.size(); i++) {
+            bounds[i] = shapeBounds(curRenderData.shapes[i]);
+        }
+        m_lightCulling.cullShapes(bounds);
+    }
+    m_permutations.request("phong", m_lightDefines);
+    m_permutations.request("depth", m_worldDefines);
+    m_fallback_shader = m_permutations.get("fallback", m_worldDefines);
+}
+
+void Realtime::watchShaderDirectory(const QString &directory) {
+    ShaderLoader::setOverrideDirectory(directory);
+    QDir dir(directory);
+    m_shaderWatcher.addPath(directory);
+    for (const QString &file : dir.entryList(QDir::Files)) {
+        m_shaderWatcher.addPath(dir.filePath(file));
+    }
+
+    auto changed = [this, directory](const QString &path) {
+        // editors often save by replacing the file, which drops it from the watcher
+        QDir dir(directory);
+        for (const QString &file : dir.entryList(QDir::Files)) {
+            if (!m_shaderWatcher.files().contains(dir.filePath(file))) {
+                m_shaderWatcher.addPath(dir.filePath(file));
+            }
+        }
+        std::cout << "Shader changed: " << path.toStdString() << std::endl;
+        m_shadersChanged = true;
+        update();
+    };
+    connect(&m_shaderWatcher, &QFileSystemWatcher::fileChanged, this, changed);
+    connect(&m_shaderWatcher, &QFileSystemWatcher::directoryChanged, this, changed);
+    std::cout << "Reading shaders from " << directory.toStdString() << " where present" << std::endl;
+}
+
+void Realtime::reloadShaders() {
+    // the scene's variants rebuild in the background and are drawn with the fallback meanwhile
+    try {
+        m_permutations.reload();
+        m_fallback_shader = m_permutations.get("fallback", m_worldDefines);
+        m_postProcessor.reload();
+    }
+    catch (const std::runtime_error &e) {
+        std::cout << "shader program failed to build:\n" << e.what() << std::endl;
+    }
+}
+
+void Realtime::setLightUniforms(GLuint program) {
     int i = 0;
 
-    for (auto& light : curRenderData.lights) {
+    for (size_t index : m_lightOrder) {
+        const SceneLightData &light = curRenderData.lights[index];
         glm::vec3 direction = -glm::vec3(light.dir);
         glm::vec3 color = glm::vec3(light.color);
-        glm::vec3 position = glm::vec3(light.pos);
+        glm::vec3 position = glm::vec3(glm::dvec3(light.worldPos) - m_worldOrigin);
         glm::vec3 attenuation = light.function;
         float light_angle = light.angle;
         float light_penu = light.penumbra;
-        int light_type = static_cast<int>(light.type);
 
 
         // send light's direction
-        GLint loc_dir = glGetUniformLocation(m_shader, ("light_directions[" + std::to_string(i) + "]").c_str());
+        GLint loc_dir = glGetUniformLocation(program, ("light_directions[" + std::to_string(i) + "]").c_str());
         glUniform3f(loc_dir, direction.x, direction.y, direction.z);
 
         // sed light's color
-        GLint loc_color = glGetUniformLocation(m_shader, ("light_colors[" + std::to_string(i) + "]").c_str());
+        GLint loc_color = glGetUniformLocation(program, ("light_colors[" + std::to_string(i) + "]").c_str());
         glUniform3f(loc_color, color.x, color.y, color.z);
 
         // send light's position
-        GLint loc_pos = glGetUniformLocation(m_shader, ("light_positions[" + std::to_string(i) + "]").c_str());
+        GLint loc_pos = glGetUniformLocation(program, ("light_positions[" + std::to_string(i) + "]").c_str());
         glUniform3f(loc_pos, position.x, position.y, position.z);
 
         // send light's attenuation
-        GLint loc_att = glGetUniformLocation(m_shader, ("light_atts[" + std::to_string(i) + "]").c_str());
+        GLint loc_att = glGetUniformLocation(program, ("light_atts[" + std::to_string(i) + "]").c_str());
         glUniform3f(loc_att, attenuation.x, attenuation.y, attenuation.z);
 
-        // send light's type
-        GLint loc_type = glGetUniformLocation(m_shader, ("light_types[" + std::to_string(i) + "]").c_str());
-        glUniform1i(loc_type, light_type);
-
         // send light's angle
-        GLint loc_angle = glGetUniformLocation(m_shader, ("light_angles[" + std::to_string(i) + "]").c_str());
+        GLint loc_angle = glGetUniformLocation(program, ("light_angles[" + std::to_string(i) + "]").c_str());
         glUniform1f(loc_angle, light_angle);
 
         // send light's type
-        GLint loc_penu = glGetUniformLocation(m_shader, ("light_penus[" + std::to_string(i) + "]").c_str());
+        GLint loc_penu = glGetUniformLocation(program, ("light_penus[" + std::to_string(i) + "]").c_str());
         glUniform1f(loc_penu, light_penu);
 
         i++;
     }
 
-    // send the number of total lights to the shader
-    glUniform1i(glGetUniformLocation(m_shader, "num_lights"), i);
-
-
-    // send the position of camera to the shader
-    glUniform3f(glGetUniformLocation(m_shader, "camera_pos"), curRenderData.cameraData.pos[0],
-                curRenderData.cameraData.pos[1],
-                curRenderData.cameraData.pos[2]);
+    if (settings.shadows) {
+        m_shadowAtlas.use(program, m_worldOrigin);
+        m_pointShadows.use(program);
+    }
+    if (settings.lightCulling) {
+        m_lightCulling.use(program);
+    }
 
+    // send the position of camera to the shader, the origin in large-world mode
+    glm::vec3 camera = glm::vec3(m_cameraPosition - m_worldOrigin);
+    glUniform3f(glGetUniformLocation(program, "camera_pos"), camera.x, camera.y, camera.z);
+}
 
-    // for each shape, bind the corresponding vao
-    for (auto& shape : curRenderData.shapes) {
-        switch (shape.primitive.type) {
-        case PrimitiveType::PRIMITIVE_CUBE:
-                glBindVertexArray(vao_cube);
-                size = d_cube.size();
-                break;
-        case PrimitiveType::PRIMITIVE_CONE:
-                glBindVertexArray(vao_cone);
-                size = d_cone.size();
-                break;
-        case PrimitiveType::PRIMITIVE_CYLINDER:
-                glBindVertexArray(vao_cyl);
-                size = d_cyl.size();
-                break;
-        case PrimitiveType::PRIMITIVE_SPHERE:
-                glBindVertexArray(vao_sphere);
-                size = d_sphere.size();
-                break;
-        default:
-                break;
-        }
+void Realtime::setShapeUniforms(GLuint program, const RenderShapeData &shape) {
+    // send shapes' ctm as a uniform, quantized meshes also need mapping back to object space
+    glm::mat4 modelMatrix, modelView;
+    shapeMatrices(shape, modelMatrix, modelView);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model_matrix"), 1, GL_FALSE, &modelMatrix[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model_view_matrix"), 1, GL_FALSE, &modelView[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model_matrix_inverse"), 1, GL_FALSE, &shape.inverse_ctm[0][0]);
+    glUniformMatrix3fv(glGetUniformLocation(program, "model_matrix_inv_trans"), 1, GL_FALSE, &shape.inverse_transpose_ctm3[0][0]);
+
+    // send view and proj matrices
+    glUniformMatrix4fv(glGetUniformLocation(program, "model_view"), 1, GL_FALSE, &curView[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model_proj"), 1, GL_FALSE, &curProj[0][0]);
+
+    // send scene light coefficients as uniforms
+    glUniform1f(glGetUniformLocation(program, "ka"), curRenderData.globalData.ka);
+    glUniform1f(glGetUniformLocation(program, "ks"), curRenderData.globalData.ks);
+    glUniform1f(glGetUniformLocation(program, "kd"), curRenderData.globalData.kd);
+
+    // send the shape's material terms as uniforms
+    glUniform4f(glGetUniformLocation(program, "cAmbient"), shape.primitive.material.cAmbient[0],
+                shape.primitive.material.cAmbient[1],
+                shape.primitive.material.cAmbient[2],
+                shape.primitive.material.cAmbient[3]);
+
+
+    glUniform4f(glGetUniformLocation(program, "cDiffuse"), shape.primitive.material.cDiffuse[0],
+                shape.primitive.material.cDiffuse[1],
+                shape.primitive.material.cDiffuse[2],
+                shape.primitive.material.cDiffuse[3]);
+
+    glUniform4f(glGetUniformLocation(program, "cSpecular"), shape.primitive.material.cSpecular[0],
+                shape.primitive.material.cSpecular[1],
+                shape.primitive.material.cSpecular[2],
+                shape.primitive.material.cSpecular[3]);
+
+    glUniform1f(glGetUniformLocation(program, "shininess"), shape.primitive.material.shininess);
+}
 
-        // send shapes' ctm as a uniform
-        glUniformMatrix4fv(glGetUniformLocation(m_shader, "model_matrix"), 1, GL_FALSE, &shape.ctm[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_shader, "model_matrix_inverse"), 1, GL_FALSE, &shape.inverse_ctm[0][0]);
-        glUniformMatrix3fv(glGetUniformLocation(m_shader, "model_matrix_inv_trans"), 1, GL_FALSE, &shape.inverse_transpose_ctm3[0][0]);
+void Realtime::shapeMatrices(const RenderShapeData &shape, glm::mat4 &model, glm::mat4 &modelView) const {
+    glm::mat4 dequantize = shape.mesh ? shape.mesh->dequantize : m_primitiveDequantize;
+    if (!settings.largeWorld) {
+        model = shape.ctm * dequantize;
+        modelView = curView * model;
+        return;
+    }
+    // subtracting the camera in double leaves an offset float holds exactly, and the view is only a
+    // rotation around the new origin; multiplying large float matrices on the GPU is what jitters
+    glm::dmat4 relative = shape.worldCtm * glm::dmat4(dequantize);
+    relative[3] -= glm::dvec4(m_worldOrigin, 0.0);
+    glm::dmat4 viewRotation = glm::dmat4(curView);
+    viewRotation[3] = glm::dvec4(0.0, 0.0, 0.0, 1.0);
+    model = glm::mat4(relative);
+    modelView = glm::mat4(viewRotation * relative);
+}
 
-        // send view and proj matrices
-        glUniformMatrix4fv(glGetUniformLocation(m_shader, "model_view"), 1, GL_FALSE, &curView[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_shader, "model_proj"), 1, GL_FALSE, &curProj[0][0]);
+void Realtime::drawShapes() {
+    updateDrawOrder();
 
-        // send scene light coefficients as uniforms
-        glUniform1f(glGetUniformLocation(m_shader, "ka"), curRenderData.globalData.ka);
-        glUniform1f(glGetUniformLocation(m_shader, "ks"), curRenderData.globalData.ks);
-        glUniform1f(glGetUniformLocation(m_shader, "kd"), curRenderData.globalData.kd);
+    // lay down the nearest depth first, so the color pass only shades the visible fragment of each pixel
+    bool prePass = settings.depthPrePass && drawDepthPrePass();
+    if (prePass) {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
 
-        // send the shape's material terms as uniforms
-        glUniform4f(glGetUniformLocation(m_shader, "cAmbient"), shape.primitive.material.cAmbient[0],
-                    shape.primitive.material.cAmbient[1],
-                    shape.primitive.material.cAmbient[2],
-                    shape.primitive.material.cAmbient[3]);
+    // the variant for the scene's lights may still be compiling
+    GLuint shader = m_permutations.ready("phong", m_lightDefines);
+    if (shader == 0) {
+        shader = m_fallback_shader;
+    }
+    glUseProgram(shader);
+    setLightUniforms(shader);
 
+    GLsizei size = 0;
 
-        glUniform4f(glGetUniformLocation(m_shader, "cDiffuse"), shape.primitive.material.cDiffuse[0],
-                    shape.primitive.material.cDiffuse[1],
-                    shape.primitive.material.cDiffuse[2],
-                    shape.primitive.material.cDiffuse[3]);
+    // for each shape, bind the corresponding vao
+    for (size_t index : m_drawOrder) {
+        const RenderShapeData &shape = curRenderData.shapes[index];
+        if (!bindShape(shape, size)) {
+            continue;
+        }
 
-        glUniform4f(glGetUniformLocation(m_shader, "cSpecular"), shape.primitive.material.cSpecular[0],
-                    shape.primitive.material.cSpecular[1],
-                    shape.primitive.material.cSpecular[2],
-                    shape.primitive.material.cSpecular[3]);
+        setShapeUniforms(shader, shape);
+        if (settings.lightCulling) {
+            glUniform1i(glGetUniformLocation(shader, "shape_light_mask"), static_cast<GLint>(m_lightCulling.shapeMask(index)));
+        }
 
-        glUniform1f(glGetUniformLocation(m_shader, "shininess"), shape.primitive.material.shininess);
         // perform draw
-        glDrawArrays(GL_TRIANGLES, 0, size / 6);
+        drawShape(shape, size);
 
         // unbind vao
         glBindVertexArray(0);
@@ -399,17 +1021,112 @@ void Realtime::drawShapes() {
     }
 
     glUseProgram(0);
+
+    if (prePass) {
+        glDepthFunc(sceneDepthFunc());
+        glDepthMask(GL_TRUE);
+    }
+}
+
+bool Realtime::updateDepthMode() {
+    bool requested = settings.reversedZ || settings.largeWorld;
+    if (requested && !m_clipControl && !m_reversedZRequested) {
+        std::cout << "Reversed-Z needs glClipControl (OpenGL 4.5 or ARB_clip_control), keeping the standard depth mapping" << std::endl;
+    }
+    m_reversedZRequested = requested;
+
+    bool reversedZ = requested && m_clipControl;
+    bool infiniteFar = reversedZ && settings.infiniteFar;
+    if (reversedZ == m_reversedZ && infiniteFar == m_infiniteFar) {
+        return false;
+    }
+    m_reversedZ = reversedZ;
+    m_infiniteFar = infiniteFar;
+    std::cout << "Projection: " << (m_reversedZ ? "reversed-Z into float depth" : "standard depth")
+              << (m_infiniteFar ? ", infinite far plane" : "") << std::endl;
+    return true;
+}
+
+void Realtime::beginSceneDepth() {
+    if (!m_reversedZ) {
+        return;
+    }
+    // depth 1 at the near plane falling to 0 far away, where a float has most of its precision;
+    // the default -1 to 1 range would add 1 to every depth and lose it again
+    glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+    glClearDepth(0.0);
+    glDepthFunc(GL_GREATER);
 }
 
+void Realtime::endSceneDepth() {
+    if (!m_reversedZ) {
+        return;
+    }
+    glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+    glClearDepth(1.0);
+    glDepthFunc(GL_LESS);
+}
+
+MeshLod Realtime::selectMeshLod(const RenderShapeData &shape) {
+    const Mesh &mesh = *shape.mesh;
+    const std::vector<MeshLod> &lods = mesh.data.lods;
+    if (lods.size() <= 1) {
+        return lods.empty() ? MeshLod{0, static_cast<GLuint>(mesh.indexCount), 0.0f} : lods[0];
+    }
+
+    // bounding sphere of the mesh in world space
+    glm::vec3 center = glm::vec3(shape.ctm * glm::vec4((mesh.data.boundsMin + mesh.data.boundsMax) * 0.5f, 1.0f));
+    float worldScale = std::max({glm::length(glm::vec3(shape.ctm[0])),
+                                 glm::length(glm::vec3(shape.ctm[1])),
+                                 glm::length(glm::vec3(shape.ctm[2]))});
+    float radius = glm::length(mesh.data.boundsMax - mesh.data.boundsMin) * 0.5f * worldScale;
+    float distance = glm::length(center - glm::vec3(curRenderData.cameraData.pos)) - radius;
+    distance = std::max(distance, settings.nearPlane);
+
+    // size of one world unit at that distance, in pixels
+    float pixelsPerUnit = m_renderTargets.internalHeight() / (2.0f * tan(curRenderData.cameraData.heightAngle / 2.0f) * distance);
+
+    // coarsest level whose projected error is still below the threshold
+    for (size_t i = lods.size() - 1; i > 0; i--) {
+        if (lods[i].error * worldScale * pixelsPerUnit <= settings.meshLodPixelError) {
+            return lods[i];
+        }
+    }
+    return lods[0];
+}
 
 // ================== Project 6: Action!
 
+namespace {
+
+// The camera key a Qt key moves, KeyCount if none
+CameraSimulation::Key cameraKey(int key) {
+    switch (key) {
+    case Qt::Key_W:       return CameraSimulation::Forward;
+    case Qt::Key_S:       return CameraSimulation::Back;
+    case Qt::Key_A:       return CameraSimulation::Left;
+    case Qt::Key_D:       return CameraSimulation::Right;
+    case Qt::Key_Space:   return CameraSimulation::Up;
+    case Qt::Key_Control: return CameraSimulation::Down;
+    default:              return CameraSimulation::KeyCount;
+    }
+}
+
+}
+
 void Realtime::keyPressEvent(QKeyEvent *event) {
-    m_keyMap[Qt::Key(event->key())] = true;
+    CameraSimulation::Key key = cameraKey(event->key());
+    // held keys repeat as release and press pairs, they stay down until the real release
+    if (key != CameraSimulation::KeyCount && !event->isAutoRepeat()) {
+        m_camera.setKey(key, true);
+    }
 }
 
 void Realtime::keyReleaseEvent(QKeyEvent *event) {
-    m_keyMap[Qt::Key(event->key())] = false;
+    CameraSimulation::Key key = cameraKey(event->key());
+    if (key != CameraSimulation::KeyCount && !event->isAutoRepeat()) {
+        m_camera.setKey(key, false);
+    }
 }
 
 void Realtime::mousePressEvent(QMouseEvent *event) {
@@ -485,118 +1202,90 @@ void Realtime::mouseMoveEvent(QMouseEvent *event) {
 }
 
 
-void Realtime::makeFBO() {
-    glGenTextures(1, &m_fbo_texture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_fbo_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-    // set linear interpolation
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Unbind
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // Generate and bind a renderbuffer of the right size, set its format, then unbind
-    glGenRenderbuffers(1, &m_fbo_renderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_fbo_renderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_fbo_width, m_fbo_height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-    // Generate and bind an FBO
-    glGenFramebuffers(1, &m_fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-
-    // Add our texture as a color attachment, and our renderbuffer as a depth+stencil attachment, to our FBO
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_fbo_texture, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_fbo_renderbuffer);
-
-    // Unbind the FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void Realtime::paintTexture(GLuint texture, bool invert, bool blur) {
-    glUseProgram(m_texture_shader);
-    glUniform1f(glGetUniformLocation(m_texture_shader, "width"), 1.0f * m_fbo_width);
-    glUniform1f(glGetUniformLocation(m_texture_shader, "height"), 1.0f * m_fbo_height);
-
-    // Task 32: Set your bool uniform on whether or not to filter the texture drawn
-    if (invert) {
-        glUniform1i(glGetUniformLocation(m_texture_shader, "post_pro"), 1);
-    }
-    else {
-        glUniform1i(glGetUniformLocation(m_texture_shader, "post_pro"), 0);
-    }
+void Realtime::benchmarkBlur() {
+    BlurPass &blur = m_postProcessor.blur();
+    RenderTargetPool &pool = m_postProcessor.pool();
+
+    for (auto [width, height] : {std::pair(1920, 1080), std::pair(3840, 2160)}) {
+        // the content doesn't matter for timing
+        GLuint source;
+        glGenTextures(1, &source);
+        glBindTexture(GL_TEXTURE_2D, source);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        for (int radius : {2, 4, 8, 16, 32, 62}) {
+            std::string suffix = " r=" + std::to_string(radius) + " " + std::to_string(width) + "x" + std::to_string(height);
+            GpuTimer::run("fragment blur" + suffix, 50, [&]() {
+                pool.release(blur.apply(source, width, height, radius, false, m_fullscreen_vao, pool));
+            });
+            if (blur.supportsCompute()) {
+                GpuTimer::run("compute blur" + suffix, 50, [&]() {
+                    pool.release(blur.apply(source, width, height, radius, false, m_fullscreen_vao, pool, BlurPass::Backend::Compute));
+                });
+            }
+            GpuTimer::run("pyramid blur" + suffix, 50, [&]() {
+                pool.release(blur.apply(source, width, height, radius, true, m_fullscreen_vao, pool));
+            });
+        }
 
-    if (blur) {
-        glUniform1i(glGetUniformLocation(m_texture_shader, "blur"), 1);
+        // don't keep the benchmark sized targets around
+        pool.clear();
+        glDeleteTextures(1, &source);
     }
-    else {
-        glUniform1i(glGetUniformLocation(m_texture_shader, "blur"), 0);
-    }
-
-
-    glBindVertexArray(m_fullscreen_vao);
-    // Task 10: Bind "texture" to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
+void Realtime::benchmarkAntialiasing() {
+    const int width = 1920;
+    const int height = 1080;
+
+    // only the final pass, which downsamples the supersampled image like the window does
+    m_postProcessor.setChain({});
+    RenderTarget output = m_postProcessor.pool().acquire(width, height);
+
+    auto run = [&](const std::string &name, float scale, int samples) {
+        RenderTargetManager targets;
+        targets.resize(width, height, 1.0);
+        targets.setScale(scale);
+        targets.setSamples(samples);
+        targets.setFloatDepth(m_reversedZ);
+        targets.update();
+
+        int internalWidth = targets.internalWidth();
+        int internalHeight = targets.internalHeight();
+        // color and depth/stencil per sample, plus the resolved texture
+        double megabytes = (internalWidth * internalHeight * (8.0 * targets.samples() + (targets.samples() > 1 ? 4.0 : 0.0))) / (1024.0 * 1024.0);
+
+        GpuTimer::run(name + " " + std::to_string(width) + "x" + std::to_string(height) + " ("
+                      + std::to_string(static_cast<int>(megabytes)) + " MB)", 50, [&]() {
+            beginSceneDepth();
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.sceneFbo());
+            glViewport(0, 0, internalWidth, internalHeight);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawShapes();
+            endSceneDepth();
+            targets.resolve();
+            m_postProcessor.render(targets.sceneTexture(), internalWidth, internalHeight, output.fbo, width, height);
+        });
+        targets.destroy();
+    };
+
+    run("no AA", 1.0f, 1);
+    run("2x MSAA", 1.0f, 2);
+    run("4x MSAA", 1.0f, 4);
+    run("8x MSAA", 1.0f, 8);
+    run("2x2 SSAA", 2.0f, 1);
+
+    m_postProcessor.pool().release(output);
+    m_postProcessor.pool().clear();
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 }
 
 void Realtime::timerEvent(QTimerEvent *event) {
-    int elapsedms   = m_elapsedTimer.elapsed();
-    float deltaTime = elapsedms * 0.001f;
-    m_elapsedTimer.restart();
-
-    float speed = 5.0f;
-
-
-    // Use deltaTime and m_keyMap here to move around
-    glm::vec3 forward = glm::normalize(glm::vec3(curRenderData.cameraData.look));
-    glm::vec3 right = glm::normalize(glm::cross(forward, glm::normalize(glm::vec3(curRenderData.cameraData.up))));
-
-    glm::vec3 translation = glm::vec3(0.0f);
-
-    if (m_keyMap[Qt::Key_W]) {
-        translation += forward;
-    }
-    if (m_keyMap[Qt::Key_S]) {
-        translation -= forward;
-    }
-    if (m_keyMap[Qt::Key_A]) {
-        translation -= right;
-    }
-    if (m_keyMap[Qt::Key_D]) {
-        translation += right;
-    }
-    if (m_keyMap[Qt::Key_Space]) {
-        translation += glm::vec3(0, 1, 0); // Upward in world space
-    }
-    if (m_keyMap[Qt::Key_Control]) {
-        translation += glm::vec3(0, -1, 0); // Downward in world space
-    }
-
-    glm::mat4 transMat = glm::mat4(1.0f);
-
-    translation *= speed * deltaTime;
-    transMat[3][0] = translation.x;
-    transMat[3][1] = translation.y;
-    transMat[3][2] = translation.z;
-
-    curRenderData.cameraData.pos = transMat * curRenderData.cameraData.pos;
-//    curRenderData.cameraData.look = transMat * curRenderData.cameraData.look;
-
-    // update view matrix
-    curRenderData.cameraData.updateView();
-    curView = curRenderData.cameraData.view;
-
-
+    // only keeps frames coming, the camera is advanced in paintGL by however much time each frame took
     update(); // asks for a PaintGL() call to occur
 }
 
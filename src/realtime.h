@@ -7,12 +7,25 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
-#include <unordered_map>
 #include <QElapsedTimer>
+#include <QFileSystemWatcher>
 #include <QOpenGLWidget>
 #include <QTime>
 #include <QTimer>
 #include "./utils/sceneparser.h"
+#include "./mesh/meshcache.h"
+#include "./mesh/meshoptimizer.h"
+#include "./mesh/vertexformat.h"
+#include "./postprocess/postprocessor.h"
+#include "./utils/rendertargetmanager.h"
+#include "./utils/frametimer.h"
+#include "./utils/dynamicresolution.h"
+#include "./utils/gbuffer.h"
+#include "./utils/shaderpermutations.h"
+#include "./utils/shadowatlas.h"
+#include "./utils/pointshadows.h"
+#include "./utils/lightculling.h"
+#include "./utils/camerasimulation.h"
 
 class Realtime : public QOpenGLWidget
 {
@@ -27,8 +40,20 @@ public:
     glm::mat4 curView;
     glm::mat4 curProj;
 
-    GLuint m_shader;
-    GLuint m_texture_shader;
+    static constexpr size_t MaxLights = 8;              // Must match the light arrays in default.frag
+
+    ProgramBinaryCache m_programCache;                  // Linked programs from earlier runs
+    ShaderPermutations m_permutations;                  // Owns every scene program
+    GLuint m_fallback_shader;                           // Drawn with until the scene's variant has compiled
+    QElapsedTimer m_startupTimer;                       // Since initializeGL, for the time to first frame
+    bool m_firstFrame = true;
+    bool m_programsReady = false;                       // Reported that no compiles are pending any more
+    QFileSystemWatcher m_shaderWatcher;                 // The --shader-dir override directory, if any
+    bool m_shadersChanged = false;                      // A watched shader was edited, reloaded on the next frame
+    std::string m_worldDefines;                         // CAMERA_RELATIVE in large-world mode, for every default.vert program
+    std::string m_lightDefines;                         // m_worldDefines plus the light counts per type of the current scene
+    glm::dvec3 m_worldOrigin = glm::dvec3(0.0);         // Subtracted from world positions before upload, the camera in large-world mode
+    std::vector<size_t> m_lightOrder;                   // Indices into curRenderData.lights, sorted by type
 
     std::vector<float> vertex_data;
 
@@ -39,47 +64,65 @@ public:
     std::vector<float> d_cyl;
 
     GLuint vbo, vao;
-    GLuint vbo_cube, vbo_sphere, vbo_cyl, vbo_cone;
-    GLuint vao_cube, vao_sphere, vao_cyl, vao_cone;
-    GLuint m_fbo_texture;
+    GLuint vbo_cube = 0, vbo_sphere = 0, vbo_cyl = 0, vbo_cone = 0;
+    GLuint vao_cube = 0, vao_sphere = 0, vao_cyl = 0, vao_cone = 0;
+    GLuint ebo_cube = 0, ebo_sphere = 0, ebo_cyl = 0, ebo_cone = 0;
+    GLsizei count_cube = 0, count_sphere = 0, count_cyl = 0, count_cone = 0;
+    int m_primitiveParam1 = -1, m_primitiveParam2 = -1;  // Settings the primitives were last built with
+    bool m_primitiveCompact = false;
+    glm::mat4 m_primitiveDequantize = glm::mat4(1.0f); // Maps compact primitive positions back to object space
     GLuint m_fullscreen_vao, m_fullscreen_vbo;
-    GLuint m_fbo_renderbuffer, m_fbo;
-    GLuint m_defaultFBO = 2;
 
-    int m_screen_width = reinterpret_cast<int>(size().width() * 2);
-    int m_screen_height = reinterpret_cast<int>(size().height() * 2);
-    int m_fbo_width = m_screen_width;
-    int m_fbo_height = m_screen_height;
+    MeshCache m_meshCache;
+    PostProcessor m_postProcessor;
+
+    RenderTargetManager m_renderTargets;
+    GBuffer m_gbuffer;
+    ShadowAtlas m_shadowAtlas;
+    PointShadows m_pointShadows;
+    LightCulling m_lightCulling;
+    FrameTimer m_frameTimer;
+    DynamicResolution m_dynamicResolution;
+    QElapsedTimer m_statsTimer;                         // Time since the frame stats were last printed
 
     float oldNear, oldFar;
 
+    bool m_clipControl = false;                         // glClipControl is available, reversed-Z needs its 0 to 1 depth range
+    bool m_reversedZ = false;                           // Near maps to depth 1 and far to 0, into a float depth buffer
+    bool m_infiniteFar = false;                         // With m_reversedZ, the far plane is at infinity
+    bool m_reversedZRequested = false;                  // Last request, to only report a missing glClipControl once
+
     void updateProjection(float near, float far, float heightAngle, float widthAngle) {
-        float c = - near / far;
-
-        glm::mat4 scaleTrans = glm::mat4(
-            glm::vec4(1, 0, 0, 0), // First column
-            glm::vec4(0, 1, 0, 0), // Second column
-            glm::vec4(0, 0, -2, 0), // Third column
-            glm::vec4(0, 0, -1, 1)  // Fourth column
-        );
-
-        glm::mat4 unhinge = glm::mat4(
-            glm::vec4(1, 0, 0, 0), // First column
-            glm::vec4(0, 1, 0, 0), // Second column
-            glm::vec4(0, 0, (1.0f / (1.0f + c)), -1), // Third column
-            glm::vec4(0, 0, (-c / (1.0f + c)), 0)  // Fourth column
-        );
-
-        glm::mat4 pers = glm::mat4(
-            glm::vec4((1.0f/(far * tan(widthAngle/2.0))), 0, 0, 0), // First column
-            glm::vec4(0, (1.0f/(far * tan(heightAngle/2.0))), 0, 0), // Second column
-            glm::vec4(0, 0, (1.0/far), 0), // Third column
-            glm::vec4(0, 0, 0, 1)  // Fourth column
-        );
-
-        curProj = scaleTrans * unhinge * pers;
+        // built directly, it is the same matrix as scaleTrans * unhinge * pers up to a factor that cancels in the divide
+        curProj = glm::mat4(0.0f);
+        curProj[0][0] = 1.0f / tan(widthAngle / 2.0f);
+        curProj[1][1] = 1.0f / tan(heightAngle / 2.0f);
+        curProj[2][3] = -1.0f;
+        if (!m_reversedZ) {
+            // near to -1, far to 1
+            curProj[2][2] = -(far + near) / (far - near);
+            curProj[3][2] = -2.0f * far * near / (far - near);
+        }
+        else if (m_infiniteFar) {
+            // near to 1, infinity to 0
+            curProj[2][2] = 0.0f;
+            curProj[3][2] = near;
+        }
+        else {
+            // near to 1, far to 0
+            curProj[2][2] = near / (far - near);
+            curProj[3][2] = far * near / (far - near);
+        }
     }
 
+    // Picks the depth mapping from the settings, returns true if it changed and the projection has to be rebuilt
+    bool updateDepthMode();
+
+    // Switches to the depth mapping of the projection around the scene passes; the shadow passes use the standard one
+    void beginSceneDepth();
+    void endSceneDepth();
+    GLenum sceneDepthFunc() const { return m_reversedZ ? GL_GREATER : GL_LESS; }
+
     void updateVAOVBO();
 
     std::vector<float> combineVectors(const std::vector<float>& vec1,
@@ -101,7 +144,7 @@ public:
         return combined;
     }
 
-    void setVertexAttributes() {
+    static void setVertexAttributes() {
         // Position
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(0));
@@ -111,25 +154,8 @@ public:
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat)));
     }
 
-    void setupShapeVAOVBO(GLuint& vao, GLuint& vbo, const std::vector<float>& vertexData) {
-        if (!vertexData.empty()) {
-            // Generate and set up the VAO
-            glGenVertexArrays(1, &vao);
-            glBindVertexArray(vao);
-
-            // Generate and bind the VBO
-            glGenBuffers(1, &vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(GLfloat), vertexData.data(), GL_STATIC_DRAW);
-
-            // Set vertex attributes
-            setVertexAttributes();
-
-            // Unbind the VBO and VAO
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
-        }
-    }
+    void setupShapeVAOVBO(GLuint& vao, GLuint& vbo, GLuint& ebo, GLsizei& indexCount,
+                          const std::vector<float>& vertexData, const std::string& name);
 
     void updateCamera(float near, float far) {
         float heightAngle = curRenderData.cameraData.heightAngle;
@@ -173,11 +199,65 @@ public:
         return rotationMatrix;
     }
 
-    void makeFBO();
+    // Filters enabled in the settings, in the order they are applied
+    std::vector<PostNode> postProcessChain();
+
+    // GPU time of the blur at 1080p and 4K across radii, for the fragment, compute and downsampled paths
+    void benchmarkBlur();
 
-    void paintTexture(GLuint texture, bool invert, bool blur);
+    // GPU time and memory of drawing the loaded scene at 1080p with MSAA against 2x2 supersampling
+    void benchmarkAntialiasing();
 
     void drawShapes();
+
+    // Same image as drawShapes(), by writing the surfaces into m_gbuffer and lighting each pixel once.
+    // Returns false without drawing while its programs are still compiling.
+    bool drawShapesDeferred();
+
+    // Sorts the lights by type and requests the default.frag variant with exactly those light counts
+    void updateLightPermutation();
+
+    // Reads shaders from directory instead of the resources and reloads them whenever a file there changes
+    void watchShaderDirectory(const QString &directory);
+    void reloadShaders();
+
+    // Light and camera uniforms of default.frag, per-shape transform and material uniforms of default.vert/frag
+    void setLightUniforms(GLuint program);
+    void setShapeUniforms(GLuint program, const RenderShapeData &shape);
+
+    // Object to world (relative to m_worldOrigin) and object to view transforms of a shape, combined in double precision
+    void shapeMatrices(const RenderShapeData &shape, glm::mat4 &model, glm::mat4 &modelView) const;
+
+    // Binds the shape's VAO and sets count for primitives. Returns false if there is nothing to draw.
+    bool bindShape(const RenderShapeData &shape, GLsizei &count);
+    void drawShape(const RenderShapeData &shape, GLsizei count);
+
+    // Fills m_drawOrder with the shapes in file order, or front to back if sorting is enabled
+    void updateDrawOrder();
+
+    // Renders the shadow atlas tiles and point light cube faces that are out of date.
+    // The atlas is skipped while the depth program is still compiling.
+    void renderShadowMaps();
+    void renderPointShadows(const std::vector<glm::vec4> &casters);
+
+    // World space bounding sphere of a shape (xyz center, w radius), and of every shape in the scene
+    glm::vec4 shapeBounds(const RenderShapeData &shape);
+    glm::vec4 sceneBounds();
+
+    // Writes the depth of every shape with color writes off, so the color pass can test GL_EQUAL.
+    // Returns false without drawing while its program is still compiling.
+    bool drawDepthPrePass();
+
+    std::vector<size_t> m_drawOrder;                    // Indices into curRenderData.shapes
+    std::vector<float> m_drawDistances;                 // Squared camera distance of each shape, for sorting
+
+    // Picks the next frame's internal resolution from the measured GPU frame times
+    void updateResolutionScale();
+
+    // Prints the GPU frame time history and the internal resolution, about once a second
+    void printFrameStats();
+
+    MeshLod selectMeshLod(const RenderShapeData &shape);
 public slots:
     void tick(QTimerEvent* event);                      // Called once per tick of m_timer
 
@@ -196,15 +276,13 @@ private:
 
     // Tick Related Variables
     int m_timer;                                        // Stores timer which attempts to run ~60 times per second
-    QElapsedTimer m_elapsedTimer;                       // Stores timer which keeps track of actual time between frames
+    QElapsedTimer m_elapsedTimer;                       // Time since the last frame advanced the camera
+    CameraSimulation m_camera;                          // Camera motion in fixed steps, drawn interpolated
+    glm::dvec3 m_cameraPosition = glm::dvec3(0.0);      // m_camera's position this frame, cameraData.pos is a float copy
 
     // Input Related Variables
     bool m_mouseDown = false;                           // Stores state of left mouse button
     glm::vec2 m_prev_mouse_pos;                         // Stores mouse position
-    std::unordered_map<Qt::Key, bool> m_keyMap;         // Stores whether keys are pressed or not
-
-    // Device Correction Variables
-    int m_devicePixelRatio = this->devicePixelRatio();
 
 
 };
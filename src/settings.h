@@ -11,6 +11,26 @@ struct Settings {
     float farPlane = 1;
     bool perPixelFilter = false;
     bool kernelBasedFilter = false;
+    int blurRadius = 2;             // In pixels of the full resolution image
+    bool sharpenFilter = false;
+    bool toneMapFilter = false;
+    bool fxaaFilter = false;
+    bool computePostProcessing = false; // Run convolution filters as compute shaders when OpenGL 4.3 is available
+    bool compactVertices = false;   // Upload 12-byte snorm16/2_10_10_10 vertices instead of 6 floats
+    bool deferredShading = false;   // Light a G-buffer instead of shading each shape as it is drawn
+    bool depthPrePass = false;      // Lay down depth first, then shade each pixel once with GL_EQUAL
+    bool sortFrontToBack = false;   // Draw shapes nearest first, so depth testing rejects more
+    int msaaSamples = 1;            // Samples per pixel of the scene buffer, 1 disables MSAA
+    bool dynamicResolution = false; // Lower the internal resolution to keep the GPU frame time under targetFrameTime
+    float targetFrameTime = 16.6f;  // In milliseconds
+    float meshLodPixelError = 1.0f; // Coarsest mesh LOD whose projected error stays below this many pixels
+    bool shadows = false;           // Shadow maps for directional (cascaded) and spot lights
+    int shadowMapSize = 1024;       // Texels per side of each shadow atlas tile, the resolution budget of a light
+    bool lightCulling = false;      // Skip point and spot lights per shape and per screen tile beyond their reach
+    float lightCutoff = 1.0f / 256.0f; // A light reaches as far as its brightest channel stays above this
+    bool largeWorld = false;        // Rebase to the camera each frame and combine transforms in double precision, implies reversedZ
+    bool reversedZ = false;         // Map near to depth 1 and far to 0 in a float depth buffer, needs glClipControl
+    bool infiniteFar = false;       // With reversed-Z, nothing is clipped by the far plane
     bool extraCredit1 = false;
     bool extraCredit2 = false;
     bool extraCredit3 = false;
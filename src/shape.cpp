@@ -13,6 +13,10 @@ public:
     virtual void setVertexData() = 0;
     std::vector<float> m_vertexData;
 
+    // Every primitive fits in [-0.5, 0.5]^3, so positions scaled by 1 / CompactScale
+    // use the whole snorm range of the compact vertex format (see vertexformat.h)
+    static constexpr float CompactScale = 0.5f;
+
 protected:
     int m_param1, m_param2;
 
@@ -0,0 +1,68 @@
+#include "utils/scenefilereader.h"
+#include "mesh/objloader.h"
+#include "mesh/binarymesh.h"
+#include "mesh/simplifier.h"
+#include "mesh/meshoptimizer.h"
+
+#include <iostream>
+#include <set>
+
+// Converts every mesh referenced by the given scene files, along with its LOD chain,
+// into the binary mesh format, written next to the source mesh. The renderer picks those up automatically.
+//
+// Usage: meshconverter <scenefile.json> [more scenefiles...]
+
+void collectMeshFiles(const SceneNode *node, std::set<const SceneNode *> &visited, std::set<std::string> &meshfiles) {
+    // template groups can be referenced from several places
+    if (node == nullptr || !visited.insert(node).second) return;
+
+    for (const ScenePrimitive *primitive : node->primitives) {
+        if (primitive->type == PrimitiveType::PRIMITIVE_MESH) {
+            meshfiles.insert(primitive->meshfile);
+        }
+    }
+    for (const SceneNode *child : node->children) {
+        collectMeshFiles(child, visited, meshfiles);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <scenefile.json> [more scenefiles...]" << std::endl;
+        return 1;
+    }
+
+    std::set<std::string> meshfiles;
+    for (int i = 1; i < argc; i++) {
+        ScenefileReader reader(argv[i]);
+        if (!reader.readJSON()) {
+            std::cout << "could not read scene " << argv[i] << std::endl;
+            return 1;
+        }
+        std::set<const SceneNode *> visited;
+        collectMeshFiles(reader.getRootNode(), visited, meshfiles);
+    }
+
+    int failures = 0;
+    for (const std::string &meshfile : meshfiles) {
+        if (BinaryMesh::isBinaryMesh(meshfile)) {
+            continue;
+        }
+
+        MeshData mesh;
+        std::string binaryPath = BinaryMesh::pathFor(meshfile);
+        if (!ObjLoader::load(meshfile, mesh)) {
+            failures++;
+            continue;
+        }
+        MeshSimplifier::buildLods(mesh);
+        MeshOptimizer::optimize(mesh, meshfile);
+        if (!BinaryMesh::write(binaryPath, mesh)) {
+            failures++;
+            continue;
+        }
+        std::cout << "Wrote " << binaryPath << " with " << mesh.lods.size() << " LODs" << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+class Benchmark {
+public:
+    // Run fn `iterations` times and print the best and average wall-clock time in milliseconds.
+    static double run(const std::string &name, int iterations, const std::function<void()> &fn) {
+        double best = 1e30;
+        double total = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            auto end = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            best = std::min(best, ms);
+            total += ms;
+        }
+        report(name, best, total / iterations);
+        return best;
+    }
+
+    static void report(const std::string &name, double bestMs, double averageMs) {
+        std::cout << "[benchmark] " << name << ": best " << bestMs << " ms, avg " << averageMs << " ms" << std::endl;
+    }
+};
@@ -0,0 +1,123 @@
+#include "camerasimulation.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+void CameraSimulation::reset(const glm::dvec3 &position) {
+    m_keys.reset();
+    m_previous = position;
+    m_current = position;
+    m_accumulator = 0.0;
+    m_steps = 0;
+    m_recording.clear();
+    m_replay.clear();
+    m_replayNext = 0;
+    m_replaying = false;
+}
+
+void CameraSimulation::setKey(Key key, bool down) {
+    if (m_replaying || m_keys.test(key) == down) {
+        return;
+    }
+    m_keys.set(key, down);
+    m_recording.push_back({m_steps, key, down});
+}
+
+int CameraSimulation::advance(double seconds, const glm::vec3 &forward, const glm::vec3 &right) {
+    m_accumulator += std::max(seconds, 0.0);
+    int steps = 0;
+    while (m_accumulator >= StepSeconds && steps < MaxStepsPerFrame) {
+        step(forward, right);
+        m_accumulator -= StepSeconds;
+        steps++;
+    }
+    if (steps == MaxStepsPerFrame) {
+        m_accumulator = std::min(m_accumulator, StepSeconds);
+    }
+    return steps;
+}
+
+void CameraSimulation::step(const glm::vec3 &forward, const glm::vec3 &right) {
+    while (m_replaying && m_replayNext < m_replay.size() && m_replay[m_replayNext].step <= m_steps) {
+        m_keys.set(m_replay[m_replayNext].key, m_replay[m_replayNext].down);
+        m_replayNext++;
+    }
+
+    glm::dvec3 direction = glm::dvec3(0.0);
+    if (m_keys.test(Forward)) {
+        direction += glm::dvec3(forward);
+    }
+    if (m_keys.test(Back)) {
+        direction -= glm::dvec3(forward);
+    }
+    if (m_keys.test(Left)) {
+        direction -= glm::dvec3(right);
+    }
+    if (m_keys.test(Right)) {
+        direction += glm::dvec3(right);
+    }
+    if (m_keys.test(Up)) {
+        direction += glm::dvec3(0.0, 1.0, 0.0); // Upward in world space
+    }
+    if (m_keys.test(Down)) {
+        direction -= glm::dvec3(0.0, 1.0, 0.0); // Downward in world space
+    }
+
+    m_previous = m_current;
+    m_current += direction * (Speed * StepSeconds);
+    m_steps++;
+}
+
+glm::dvec3 CameraSimulation::position() const {
+    // not glm::mix, a * (1 - t) + a * t isn't always exactly a once the camera has stopped
+    return m_previous + (m_current - m_previous) * std::clamp(m_accumulator / StepSeconds, 0.0, 1.0);
+}
+
+void CameraSimulation::replay(const std::vector<KeyEvent> &events) {
+    m_replay = events;
+    m_replayNext = 0;
+    m_replaying = true;
+}
+
+void CameraSimulation::benchmarkFrameRates() {
+    const glm::vec3 forward = glm::vec3(0.0f, 0.0f, -1.0f);
+    const glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+    // two seconds, every key is up well before the end so runs that overshoot by a frame still agree
+    const uint64_t totalSteps = 240;
+
+    // forward, then forward and right, then up, with the keys changing between frames
+    CameraSimulation live;
+    live.reset(glm::dvec3(0.0));
+    for (int frame = 0; live.steps() < totalSteps; frame++) {
+        if (frame == 10) live.setKey(Forward, true);
+        if (frame == 40) live.setKey(Right, true);
+        if (frame == 70) live.setKey(Forward, false);
+        if (frame == 80) live.setKey(Right, false);
+        if (frame == 90) live.setKey(Up, true);
+        if (frame == 100) live.setKey(Up, false);
+        live.advance(1.0 / 60.0, forward, right);
+    }
+    glm::dvec3 expected = live.position();
+    std::cout << "Camera simulation: 60 fps live ends at (" << expected.x << ", " << expected.y << ", " << expected.z
+              << ")" << std::endl;
+
+    // the recording at other frame rates, the last one with frame times jittering between 2 and 40 ms
+    uint32_t seed = 1;
+    auto jitter = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return 0.002 + 0.038 * (seed >> 8) / static_cast<double>(1u << 24);
+    };
+    for (double fps : {30.0, 144.0, 0.0}) {
+        CameraSimulation replayed;
+        replayed.reset(glm::dvec3(0.0));
+        replayed.replay(live.recording());
+        while (replayed.steps() < totalSteps) {
+            replayed.advance(fps > 0.0 ? 1.0 / fps : jitter(), forward, right);
+        }
+        glm::dvec3 end = replayed.position();
+        std::cout << "Camera simulation: " << (fps > 0.0 ? std::to_string(static_cast<int>(fps)) + " fps" : std::string("jittered"))
+                  << " replay ends at (" << end.x << ", " << end.y << ", " << end.z << ")"
+                  << (end == expected ? ", identical" : ", DIFFERENT") << std::endl;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+// Moves the camera in fixed steps of StepSeconds, independent of how often frames are drawn. The
+// time of each frame goes into an accumulator and every whole step in it is taken; the camera is
+// drawn between the last two steps by the fraction left over, so motion is smooth at any frame
+// rate while the simulation itself only ever sees the same step.
+//
+// Key changes take effect at the next step and are recorded with its number. Feeding a recording
+// to replay() reproduces the same path exactly, however the time is split into frames.
+class CameraSimulation {
+public:
+    enum Key { Forward, Back, Left, Right, Up, Down, KeyCount };
+
+    struct KeyEvent {
+        uint64_t step = 0;      // Takes effect before this step
+        Key key = Forward;
+        bool down = false;
+    };
+
+    static constexpr double StepSeconds = 1.0 / 120.0;
+    static constexpr int MaxStepsPerFrame = 12;     // A longer stall drops the time instead of catching up
+    static constexpr double Speed = 5.0;            // World units per second
+
+    // Starts over at position with no keys down, e.g. after a scene was loaded
+    void reset(const glm::dvec3 &position);
+
+    void setKey(Key key, bool down);
+
+    // Takes the whole steps in seconds plus what was left over from earlier frames, moving along
+    // the view's forward and right, and world up and down. Returns the number of steps taken.
+    int advance(double seconds, const glm::vec3 &forward, const glm::vec3 &right);
+
+    // False once every key is up and the last step has been drawn
+    bool moving() const { return m_keys.any() || m_previous != m_current; }
+
+    // Position to draw, between the last two steps
+    glm::dvec3 position() const;
+
+    uint64_t steps() const { return m_steps; }
+
+    // Key changes so far, stamped with their step
+    const std::vector<KeyEvent> &recording() const { return m_recording; }
+
+    // Applies events at their steps instead of live keys, from the current step on
+    void replay(const std::vector<KeyEvent> &events);
+
+    // Records a short session at 60 fps and replays it at other, uneven frame rates, printing
+    // where each run ends; they must all agree.
+    static void benchmarkFrameRates();
+
+private:
+    void step(const glm::vec3 &forward, const glm::vec3 &right);
+
+    std::bitset<KeyCount> m_keys;
+    glm::dvec3 m_previous = glm::dvec3(0.0);
+    glm::dvec3 m_current = glm::dvec3(0.0);
+    double m_accumulator = 0.0;                 // Seconds not yet simulated, less than a step after advance()
+    uint64_t m_steps = 0;
+
+    std::vector<KeyEvent> m_recording;
+    std::vector<KeyEvent> m_replay;
+    size_t m_replayNext = 0;
+    bool m_replaying = false;
+};
@@ -0,0 +1,41 @@
+#include "dynamicresolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+float DynamicResolution::update(double frameMs, double targetMs) {
+    if (frameMs <= 0.0 || targetMs <= 0.0) {
+        return m_scale;
+    }
+
+    // a moving average, so one slow frame doesn't change the resolution
+    m_smoothedMs = m_framesSinceChange == 0 ? frameMs : 0.9 * m_smoothedMs + 0.1 * frameMs;
+    m_framesSinceChange++;
+    if (m_framesSinceChange < SettleFrames) {
+        return m_scale;
+    }
+
+    float ideal = m_scale * static_cast<float>(std::sqrt(targetMs / m_smoothedMs));
+    float scale = m_scale;
+    if (m_smoothedMs > targetMs) {
+        // over budget, go straight to the largest step that fits
+        scale = std::min(m_scale - Step, std::floor(ideal / Step) * Step);
+    }
+    else if ((m_scale + Step) * (m_scale + Step) * m_smoothedMs < Headroom * targetMs * m_scale * m_scale) {
+        scale = m_scale + Step;
+    }
+    // round away the drift of repeatedly adding Step
+    scale = std::clamp(std::round(scale / Step) * Step, MinScale, MaxScale);
+
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_framesSinceChange = 0;
+    }
+    return m_scale;
+}
+
+void DynamicResolution::reset() {
+    m_scale = MaxScale;
+    m_smoothedMs = 0.0;
+    m_framesSinceChange = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Picks the scale of the internal resolution that keeps the GPU frame time under a target.
+// GPU time is taken to grow with the pixel count, so the ideal scale is the current one times
+// sqrt(target / measured). The scale is quantized to Step, drops as far as needed at once but
+// only grows one step at a time, and after every change waits SettleFrames so the measurements
+// reflect the new resolution before deciding again.
+class DynamicResolution {
+public:
+    static constexpr float MinScale = 0.5f;
+    static constexpr float MaxScale = 1.0f;
+    static constexpr float Step = 0.05f;
+    static constexpr int SettleFrames = 15;
+    static constexpr double Headroom = 0.8;   // Only grow if a step up would still fit this fraction of the target
+
+    // Feeds the GPU time of one frame in milliseconds and returns the scale for the next ones.
+    float update(double frameMs, double targetMs);
+
+    void reset();
+
+    float scale() const { return m_scale; }
+
+private:
+    float m_scale = MaxScale;
+    double m_smoothedMs = 0.0;
+    int m_framesSinceChange = 0;
+};
@@ -0,0 +1,80 @@
+#include "frametimer.h"
+
+#include <algorithm>
+#include <numeric>
+
+void FrameTimer::initialize() {
+    glGenQueries(QueryCount, m_queries);
+    std::fill(m_pending, m_pending + QueryCount, false);
+    m_next = 0;
+    m_active = false;
+    m_history.clear();
+}
+
+void FrameTimer::destroy() {
+    if (m_queries[0] != 0) {
+        glDeleteQueries(QueryCount, m_queries);
+    }
+    std::fill(m_queries, m_queries + QueryCount, 0);
+    std::fill(m_pending, m_pending + QueryCount, false);
+}
+
+void FrameTimer::begin() {
+    collect();
+    // the GPU is more than QueryCount frames behind, skip this frame rather than wait for it
+    m_active = m_queries[m_next] != 0 && !m_pending[m_next];
+    if (m_active) {
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    }
+}
+
+void FrameTimer::end() {
+    if (!m_active) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % QueryCount;
+    m_active = false;
+}
+
+bool FrameTimer::collect() {
+    bool collected = false;
+    // oldest first, results become available in submission order
+    for (int i = 0; i < QueryCount; i++) {
+        int index = (m_next + i) % QueryCount;
+        if (!m_pending[index]) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &nanoseconds);
+        m_pending[index] = false;
+
+        m_history.push_back(nanoseconds * 1e-6);
+        if (m_history.size() > HistorySize) {
+            m_history.pop_front();
+        }
+        collected = true;
+    }
+    return collected;
+}
+
+double FrameTimer::average() const {
+    if (m_history.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(m_history.begin(), m_history.end(), 0.0) / m_history.size();
+}
+
+double FrameTimer::worst() const {
+    if (m_history.empty()) {
+        return 0.0;
+    }
+    return *std::max_element(m_history.begin(), m_history.end());
+}
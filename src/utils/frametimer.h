@@ -0,0 +1,42 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <deque>
+
+// Measures the GPU time of every frame with GL_TIME_ELAPSED queries, without stalling: queries are
+// kept in a small ring and only read back once their result is available, a few frames later.
+// Unlike GpuTimer this is meant to run continuously alongside rendering. Requires a current context.
+class FrameTimer {
+public:
+    static constexpr int QueryCount = 4;        // Frames that can be in flight before a frame goes untimed
+    static constexpr size_t HistorySize = 120;  // Frame times kept for the stats
+
+    void initialize();
+    void destroy();
+
+    // Brackets the GPU work of one frame. Queries can't nest, so nothing else may time in between.
+    void begin();
+    void end();
+
+    // Reads back every finished query into the history. Returns true if there were any.
+    bool collect();
+
+    // In milliseconds, 0 until the first frame has been read back
+    double latest() const { return m_history.empty() ? 0.0 : m_history.back(); }
+    double average() const;
+    double worst() const;
+    const std::deque<double> &history() const { return m_history; }
+
+private:
+    GLuint m_queries[QueryCount] = {};
+    bool m_pending[QueryCount] = {};
+    int m_next = 0;       // Query the next frame is timed with, also the oldest one in flight
+    bool m_active = false;
+
+    std::deque<double> m_history;
+};
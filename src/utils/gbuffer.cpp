@@ -0,0 +1,62 @@
+#include "gbuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+void GBuffer::resize(int width, int height, bool floatDepth) {
+    width = std::max(1, width);
+    height = std::max(1, height);
+    if (m_fbo != 0 && width == m_width && height == m_height && floatDepth == m_floatDepth) {
+        return;
+    }
+    destroy();
+    m_width = width;
+    m_height = height;
+    m_floatDepth = floatDepth;
+
+    const GLenum formats[AttachmentCount] = {GL_RGBA32F, GL_RGBA32F, GL_RGBA16F, GL_RGBA16F, GL_RGBA16F};
+    GLenum drawBuffers[AttachmentCount];
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    glGenTextures(AttachmentCount, m_textures);
+    for (int i = 0; i < AttachmentCount; i++) {
+        glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, formats[i], m_width, m_height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        // read with texelFetch, one texel per pixel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i], 0);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDrawBuffers(AttachmentCount, drawBuffers);
+
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, m_floatDepth ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "g-buffer is incomplete at " << m_width << "x" << m_height << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "G-buffer: " << m_width << "x" << m_height << ", "
+              << static_cast<size_t>(m_width) * m_height * (2 * 16 + 3 * 8 + 4) / (1024 * 1024) << " MB" << std::endl;
+}
+
+void GBuffer::destroy() {
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteTextures(AttachmentCount, m_textures);
+        glDeleteRenderbuffers(1, &m_depth);
+    }
+    m_fbo = 0;
+    std::fill(m_textures, m_textures + AttachmentCount, 0);
+    m_depth = 0;
+    m_width = 0;
+    m_height = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+// Render targets of the deferred renderer's geometry pass, one texture per gbuffer.frag output
+// plus its own depth buffer. Positions and normals are stored as 32-bit floats so the lighting
+// matches the forward path, the premultiplied material colors as 16-bit floats.
+class GBuffer {
+public:
+    enum Attachment { Position, Normal, Ambient, Diffuse, Specular, AttachmentCount };
+
+    // Reallocates the attachments if the size or the depth format differs. Requires a current context.
+    void resize(int width, int height, bool floatDepth = false);
+    void destroy();
+
+    GLuint fbo() const { return m_fbo; }
+    GLuint texture(Attachment attachment) const { return m_textures[attachment]; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    GLuint m_fbo = 0;
+    GLuint m_textures[AttachmentCount] = {};
+    GLuint m_depth = 0;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_floatDepth = false;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#include "benchmark.h"
+
+// GPU-side counterpart of Benchmark, timed with GL_TIME_ELAPSED queries. Requires a current context.
+class GpuTimer {
+public:
+    // Run fn `iterations` times after one warm-up run and print the best and average GPU time in milliseconds.
+    static double run(const std::string &name, int iterations, const std::function<void()> &fn) {
+        GLuint query;
+        glGenQueries(1, &query);
+
+        fn();
+        glFinish();
+
+        double best = 1e30;
+        double total = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            fn();
+            glEndQuery(GL_TIME_ELAPSED);
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            double ms = nanoseconds * 1e-6;
+            best = std::min(best, ms);
+            total += ms;
+        }
+
+        glDeleteQueries(1, &query);
+        Benchmark::report(name, best, total / iterations);
+        return best;
+    }
+};
@@ -0,0 +1,224 @@
+#include "lightculling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+const char *typeName(LightType type) {
+    switch (type) {
+    case LightType::LIGHT_DIRECTIONAL: return "directional";
+    case LightType::LIGHT_POINT:       return "point";
+    default:                           return "spot";
+    }
+}
+
+// default.frag's attenuation() of the light at distance
+float attenuation(const SceneLightData &light, float distance) {
+    return 1.0f / (light.function.x + light.function.y * distance + light.function.z * distance * distance);
+}
+
+}
+
+float LightCulling::influenceRadius(const SceneLightData &light, float cutoff) {
+    float intensity = std::max({light.color.r, light.color.g, light.color.b});
+    float c = light.function.x;
+    float l = light.function.y;
+    float q = light.function.z;
+    float target = intensity / cutoff; // attenuation denominator at that distance
+    if (intensity <= 0.0f || c >= target) {
+        return 0.0f;
+    }
+    if (q > 0.0f) {
+        return (-l + std::sqrt(l * l - 4.0f * q * (c - target))) / (2.0f * q);
+    }
+    if (l > 0.0f) {
+        return (target - c) / l;
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+void LightCulling::setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, float cutoff) {
+    m_lights.clear();
+    m_radii.clear();
+    m_alwaysOn = 0;
+    m_tilesValid = false;
+
+    for (size_t slot = 0; slot < order.size(); slot++) {
+        const SceneLightData &light = lights[order[slot]];
+        m_lights.push_back(light);
+        if (light.type == LightType::LIGHT_DIRECTIONAL) {
+            m_radii.push_back(std::numeric_limits<float>::infinity());
+            m_alwaysOn |= 1u << slot;
+            continue;
+        }
+
+        float radius = influenceRadius(light, cutoff);
+        m_radii.push_back(radius);
+        if (std::isinf(radius)) {
+            m_alwaysOn |= 1u << slot;
+            std::cout << "Light culling: " << typeName(light.type) << " light " << slot
+                      << " has no distance falloff and is never culled" << std::endl;
+            continue;
+        }
+
+        // the brightest channel at the radius; everything culled is further away and dimmer still
+        float intensity = std::max({light.color.r, light.color.g, light.color.b});
+        std::cout << "Light culling: " << typeName(light.type) << " light " << slot << " reaches " << radius
+                  << ", contributes " << intensity * attenuation(light, radius) << " there (cutoff " << cutoff << ")"
+                  << std::endl;
+    }
+}
+
+void LightCulling::cullShapes(const std::vector<glm::vec4> &shapeBounds) {
+    m_shapeMasks.assign(shapeBounds.size(), m_alwaysOn);
+    size_t lit = 0;
+    for (size_t s = 0; s < shapeBounds.size(); s++) {
+        glm::vec3 center = glm::vec3(shapeBounds[s]);
+        float radius = shapeBounds[s].w;
+        for (size_t slot = 0; slot < m_lights.size(); slot++) {
+            const SceneLightData &light = m_lights[slot];
+            float reach = m_radii[slot];
+            if ((m_alwaysOn >> slot) & 1u) {
+                continue;
+            }
+            glm::vec3 toShape = center - glm::vec3(light.pos);
+            float distance = glm::length(toShape);
+            if (distance > reach + radius) {
+                continue;
+            }
+            if (light.type == LightType::LIGHT_SPOT) {
+                // distance of the sphere's center outside the cone's surface, and behind its apex
+                glm::vec3 axis = glm::normalize(glm::vec3(light.dir));
+                float along = glm::dot(toShape, axis);
+                float across = std::sqrt(std::max(distance * distance - along * along, 0.0f));
+                float outside = std::cos(light.angle) * across - std::sin(light.angle) * along;
+                if (outside > radius || along < -radius) {
+                    continue;
+                }
+            }
+            m_shapeMasks[s] |= 1u << slot;
+        }
+        for (size_t slot = 0; slot < m_lights.size(); slot++) {
+            lit += (m_shapeMasks[s] >> slot) & 1u;
+        }
+    }
+
+    if (!shapeBounds.empty() && !m_lights.empty()) {
+        std::cout << "Light culling: " << static_cast<float>(lit) / shapeBounds.size() << " of " << m_lights.size()
+                  << " lights per shape on average" << std::endl;
+    }
+}
+
+bool LightCulling::tileBounds(size_t slot, const glm::mat4 &view, const glm::mat4 &proj, float near,
+                              int width, int height, glm::ivec4 &bounds) const {
+    int tilesX = (width + TileSize - 1) / TileSize;
+    int tilesY = (height + TileSize - 1) / TileSize;
+    glm::vec3 center = glm::vec3(view * m_lights[slot].pos);
+    float radius = m_radii[slot];
+
+    // the camera looks down -z, a sphere entirely closer than the near plane is clipped away
+    if (center.z - radius >= -near) {
+        return false;
+    }
+    // crossing the near plane, the projection of the corners behind it is meaningless
+    if (center.z + radius > -near) {
+        bounds = glm::ivec4(0, 0, tilesX - 1, tilesY - 1);
+        return true;
+    }
+
+    // the projected corners of the sphere's box contain the projected sphere
+    glm::vec2 ndcMin = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 ndcMax = glm::vec2(std::numeric_limits<float>::lowest());
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 offset = glm::vec3(corner & 1 ? radius : -radius,
+                                     corner & 2 ? radius : -radius,
+                                     corner & 4 ? radius : -radius);
+        glm::vec4 clip = proj * glm::vec4(center + offset, 1.0f);
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+    if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) {
+        return false;
+    }
+
+    glm::vec2 size = glm::vec2(width, height);
+    glm::vec2 pixelMin = (glm::clamp(ndcMin, -1.0f, 1.0f) * 0.5f + 0.5f) * size;
+    glm::vec2 pixelMax = (glm::clamp(ndcMax, -1.0f, 1.0f) * 0.5f + 0.5f) * size;
+    bounds = glm::ivec4(std::clamp(static_cast<int>(pixelMin.x) / TileSize, 0, tilesX - 1),
+                        std::clamp(static_cast<int>(pixelMin.y) / TileSize, 0, tilesY - 1),
+                        std::clamp(static_cast<int>(pixelMax.x) / TileSize, 0, tilesX - 1),
+                        std::clamp(static_cast<int>(pixelMax.y) / TileSize, 0, tilesY - 1));
+    return true;
+}
+
+void LightCulling::cullTiles(const glm::mat4 &view, const glm::mat4 &proj, float near, int width, int height) {
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    int tilesX = (width + TileSize - 1) / TileSize;
+    int tilesY = (height + TileSize - 1) / TileSize;
+    if (m_texture == 0 || tilesX != m_tilesX || tilesY != m_tilesY) {
+        if (m_texture == 0) {
+            glGenTextures(1, &m_texture);
+        }
+        m_tilesX = tilesX;
+        m_tilesY = tilesY;
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, m_tilesX, m_tilesY, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_tilesValid = false;
+    }
+    if (m_tilesValid && view == m_tileView && proj == m_tileProj) {
+        return;
+    }
+
+    m_tiles.assign(static_cast<size_t>(m_tilesX) * m_tilesY, static_cast<uint8_t>(m_alwaysOn));
+    for (size_t slot = 0; slot < m_lights.size(); slot++) {
+        glm::ivec4 bounds;
+        if (((m_alwaysOn >> slot) & 1u) || m_radii[slot] <= 0.0f ||
+            !tileBounds(slot, view, proj, near, width, height, bounds)) {
+            continue;
+        }
+        for (int y = bounds.y; y <= bounds.w; y++) {
+            for (int x = bounds.x; x <= bounds.z; x++) {
+                m_tiles[static_cast<size_t>(y) * m_tilesX + x] |= static_cast<uint8_t>(1u << slot);
+            }
+        }
+    }
+
+    // rows of single bytes aren't 4-byte aligned
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_tilesX, m_tilesY, GL_RED_INTEGER, GL_UNSIGNED_BYTE, m_tiles.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_tileView = view;
+    m_tileProj = proj;
+    m_tilesValid = true;
+}
+
+void LightCulling::use(GLuint program) const {
+    glActiveTexture(GL_TEXTURE0 + TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "light_tiles"), TextureUnit);
+    glUniform1i(glGetUniformLocation(program, "light_tile_size"), TileSize);
+}
+
+void LightCulling::destroy() {
+    if (m_texture != 0) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+    m_tilesX = 0;
+    m_tilesY = 0;
+    m_tilesValid = false;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "scenedata.h"
+
+// Skips point and spot lights where their contribution can't be seen. Each light reaches as far
+// as its influence radius, the distance at which its attenuation has brought its brightest
+// channel down to the cutoff. Every light term in default.frag is the light's color times the
+// attenuation, scaled by the material and by factors no larger than 1, and the attenuation only
+// falls with distance, so nothing skipped beyond the radius adds more than the cutoff per unit of
+// material reflectance.
+//
+// The radius is used twice: on the CPU every shape gets a mask of the lights whose sphere (and
+// cone, for spot lights) reaches its bounding sphere, and the screen is split into TileSize
+// pixel tiles, each with a mask of the lights whose projected sphere covers it. The tile masks
+// are uploaded as a texture and default.frag compiled with LIGHT_CULLING only evaluates the
+// lights set in both. Directional lights are never culled.
+class LightCulling {
+public:
+    static constexpr int TileSize = 16;         // In pixels of the internal resolution
+    static constexpr int TextureUnit = 12;      // Past the point shadow cubes
+
+    // Distance at which the light's brightest channel has been attenuated down to cutoff,
+    // infinity if its attenuation never gets there.
+    static float influenceRadius(const SceneLightData &light, float cutoff);
+
+    // The lights uploaded to default.frag, in order. Prints each radius with the contribution
+    // measured there.
+    void setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, float cutoff);
+
+    // Per shape light masks, from the shapes' bounding spheres (xyz center, w radius).
+    void cullShapes(const std::vector<glm::vec4> &shapeBounds);
+    uint32_t shapeMask(size_t shape) const { return shape < m_shapeMasks.size() ? m_shapeMasks[shape] : AllLights; }
+
+    // Rebuilds the tile masks for the camera if it or the size changed. Requires a current context.
+    void cullTiles(const glm::mat4 &view, const glm::mat4 &proj, float near, int width, int height);
+
+    // Binds the tile masks to TextureUnit and sets the culling uniforms of default.frag.
+    void use(GLuint program) const;
+
+    void destroy();
+
+    float radius(size_t slot) const { return m_radii[slot]; }
+
+private:
+    static constexpr uint32_t AllLights = 0xFF;
+
+    // First and last tile covered by the light's sphere on a width x height screen, false if it is
+    // entirely off screen.
+    bool tileBounds(size_t slot, const glm::mat4 &view, const glm::mat4 &proj, float near,
+                    int width, int height, glm::ivec4 &bounds) const;
+
+    std::vector<SceneLightData> m_lights;       // In upload order
+    std::vector<float> m_radii;
+    std::vector<uint32_t> m_shapeMasks;
+    uint32_t m_alwaysOn = 0;                    // Directional and unbounded lights
+
+    GLuint m_texture = 0;
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+    std::vector<uint8_t> m_tiles;
+    glm::mat4 m_tileView = glm::mat4(0.0f);     // Camera the tiles were built for
+    glm::mat4 m_tileProj = glm::mat4(0.0f);
+    bool m_tilesValid = false;
+};
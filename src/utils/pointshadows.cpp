@@ -0,0 +1,285 @@
+#include "pointshadows.h"
+#include "lightculling.h"
+
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+
+void PointShadows::setProgram(GLuint program) {
+    if (program == m_program) {
+        return;
+    }
+    // a reloaded program may render the cubes differently
+    invalidate();
+    m_program = program;
+    m_faceMatricesLocation = glGetUniformLocation(m_program, "face_matrices");
+    m_firstLayerLocation = glGetUniformLocation(m_program, "first_layer");
+    m_faceMaskLocation = glGetUniformLocation(m_program, "face_mask");
+    m_lightPositionLocation = glGetUniformLocation(m_program, "light_position");
+    m_farPlaneLocation = glGetUniformLocation(m_program, "far_plane");
+    m_modelLocation = glGetUniformLocation(m_program, "model_matrix");
+}
+
+void PointShadows::setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, int baseSize,
+                             const glm::vec3 &sceneCenter, float sceneRadius) {
+    m_baseSize = std::clamp(baseSize, 64, 2048);
+    m_lights.clear();
+    for (size_t slot = 0; slot < order.size(); slot++) {
+        const SceneLightData &data = lights[order[slot]];
+        if (data.type != LightType::LIGHT_POINT) {
+            continue;
+        }
+        Light light;
+        light.slot = slot;
+        light.position = glm::vec3(data.pos);
+        // nothing beyond the far side of the scene casts a shadow either
+        float sceneFar = glm::distance(light.position, sceneCenter) + std::max(sceneRadius, 1.0f);
+        light.radius = std::max(0.1f, std::min(LightCulling::influenceRadius(data, 1.0f / 256.0f), sceneFar));
+        m_lights.push_back(light);
+    }
+    m_casters.clear();
+}
+
+void PointShadows::invalidate() {
+    for (Light &light : m_lights) {
+        light.dirtyFaces = AllFaces;
+    }
+}
+
+void PointShadows::invalidate(const glm::vec4 &sphere) {
+    for (Light &light : m_lights) {
+        light.dirtyFaces |= faceMask(light, sphere);
+    }
+}
+
+void PointShadows::updateCasters(const std::vector<glm::vec4> &casters) {
+    if (casters.size() != m_casters.size()) {
+        invalidate();
+    }
+    else {
+        for (size_t i = 0; i < casters.size(); i++) {
+            if (casters[i] != m_casters[i]) {
+                // the faces it left and the faces it entered
+                invalidate(m_casters[i]);
+                invalidate(casters[i]);
+            }
+        }
+    }
+    m_casters = casters;
+}
+
+void PointShadows::updateImportance(const glm::vec3 &camera) {
+    // about the fraction of the view the light's sphere of influence covers, 1 from inside it
+    for (Light &light : m_lights) {
+        light.importance = light.radius / std::max(glm::distance(camera, light.position), light.radius);
+    }
+    std::vector<size_t> ranked(m_lights.size());
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [this](size_t a, size_t b) { return m_lights[a].importance > m_lights[b].importance; });
+
+    std::vector<int> tiers(m_lights.size(), -1);
+    size_t next = 0;
+    for (int tier = 0; tier < TierCount; tier++) {
+        for (int i = 0; i < TierCubes[tier] && next < ranked.size(); i++) {
+            tiers[ranked[next++]] = tier;
+        }
+    }
+
+    // lights that stay in their tier keep their cube and its cached faces
+    bool used[TierCount][8] = {};
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        if (tiers[i] >= 0 && tiers[i] == m_lights[i].tier) {
+            used[tiers[i]][m_lights[i].cube] = true;
+        }
+    }
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        Light &light = m_lights[i];
+        if (tiers[i] == light.tier) {
+            continue;
+        }
+        light.tier = tiers[i];
+        light.cube = 0;
+        if (light.tier >= 0) {
+            while (used[light.tier][light.cube]) {
+                light.cube++;
+            }
+            used[light.tier][light.cube] = true;
+        }
+        light.dirtyFaces = AllFaces;
+        light.rendered = false;
+    }
+}
+
+bool PointShadows::needsRendering() const {
+    return std::any_of(m_lights.begin(), m_lights.end(),
+                       [](const Light &light) { return light.tier >= 0 && light.dirtyFaces != 0; });
+}
+
+void PointShadows::allocate() {
+    if (m_fbo != 0 && m_allocatedSize == m_baseSize) {
+        return;
+    }
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteFramebuffers(1, &m_clearFbo);
+        glDeleteTextures(TierCount, m_textures);
+    }
+    m_allocatedSize = m_baseSize;
+
+    size_t bytes = 0;
+    glGenTextures(TierCount, m_textures);
+    for (int tier = 0; tier < TierCount; tier++) {
+        int size = tierSize(tier);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_textures[tier]);
+        glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, 6 * TierCubes[tier], 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        // read with samplerCubeArrayShadow, linear filtering blends four comparisons
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        bytes += static_cast<size_t>(size) * size * 6 * TierCubes[tier] * 4;
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    // the attachments are set per light, neither has a color buffer
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glGenFramebuffers(1, &m_clearFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_clearFbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (Light &light : m_lights) {
+        light.dirtyFaces = AllFaces;
+        light.rendered = false;
+    }
+    std::cout << "Point shadows: cubes of " << tierSize(0) << ", " << tierSize(1) << " and " << tierSize(2)
+              << " texels, " << bytes / (1024 * 1024) << " MB" << std::endl;
+}
+
+void PointShadows::beginLight(size_t i) {
+    const Light &light = m_lights[i];
+    GLuint texture = m_textures[light.tier];
+    int firstLayer = 6 * light.cube;
+
+    // only the dirty faces lose their cached depth
+    glBindFramebuffer(GL_FRAMEBUFFER, m_clearFbo);
+    for (int face = 0; face < 6; face++) {
+        if (light.dirtyFaces & (1 << face)) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, firstLayer + face);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+    int size = tierSize(light.tier);
+    glViewport(0, 0, size, size);
+
+    // the orientations OpenGL samples the faces of a cube map with
+    static const glm::vec3 directions[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    static const glm::vec3 ups[6] = {{0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0}};
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, std::min(0.05f, light.radius * 0.01f), light.radius);
+    glm::mat4 faceMatrices[6];
+    for (int face = 0; face < 6; face++) {
+        faceMatrices[face] = proj * glm::lookAt(light.position, light.position + directions[face], ups[face]);
+    }
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_faceMatricesLocation, 6, GL_FALSE, &faceMatrices[0][0][0]);
+    glUniform1i(m_firstLayerLocation, firstLayer);
+    glUniform3f(m_lightPositionLocation, light.position.x, light.position.y, light.position.z);
+    glUniform1f(m_farPlaneLocation, light.radius);
+}
+
+bool PointShadows::setCaster(size_t i, const glm::vec4 &bounds, const glm::mat4 &modelMatrix) {
+    int mask = m_lights[i].dirtyFaces & faceMask(m_lights[i], bounds);
+    if (mask == 0) {
+        return false;
+    }
+    glUniform1i(m_faceMaskLocation, mask);
+    glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, &modelMatrix[0][0]);
+    return true;
+}
+
+void PointShadows::endLight(size_t i) {
+    m_lights[i].dirtyFaces = 0;
+    m_lights[i].rendered = true;
+}
+
+void PointShadows::end() {
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadows::use(GLuint program) const {
+    for (int tier = 0; tier < TierCount; tier++) {
+        glActiveTexture(GL_TEXTURE0 + FirstTextureUnit + tier);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_textures[tier]);
+        glUniform1i(glGetUniformLocation(program, ("point_shadow_tier" + std::to_string(tier)).c_str()),
+                    FirstTextureUnit + tier);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    for (const Light &light : m_lights) {
+        std::string index = "[" + std::to_string(light.slot) + "]";
+        // a cube that was never rendered would read undefined depth
+        int tier = light.rendered ? light.tier : -1;
+        glUniform1i(glGetUniformLocation(program, ("point_shadow_tiers" + index).c_str()), tier);
+        glUniform1i(glGetUniformLocation(program, ("point_shadow_cubes" + index).c_str()), light.cube);
+        glUniform1f(glGetUniformLocation(program, ("point_shadow_far" + index).c_str()), light.radius);
+        glUniform1f(glGetUniformLocation(program, ("point_shadow_sizes" + index).c_str()),
+                    tier >= 0 ? static_cast<float>(tierSize(tier)) : 1.0f);
+    }
+}
+
+void PointShadows::destroy() {
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteFramebuffers(1, &m_clearFbo);
+        glDeleteTextures(TierCount, m_textures);
+    }
+    m_fbo = 0;
+    m_clearFbo = 0;
+    std::fill(m_textures, m_textures + TierCount, 0);
+    m_allocatedSize = 0;
+    m_program = 0;
+    for (Light &light : m_lights) {
+        light.dirtyFaces = AllFaces;
+        light.rendered = false;
+    }
+}
+
+int PointShadows::faceMask(const Light &light, const glm::vec4 &sphere) {
+    glm::vec3 offset = glm::vec3(sphere) - light.position;
+    float radius = sphere.w;
+    if (glm::length(offset) > light.radius + radius) {
+        return 0;
+    }
+    // face f looks along +-axis; its frustum is bounded by the planes major = +-minor, whose normals have length sqrt(2)
+    int mask = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int sign = 0; sign < 2; sign++) {
+            float major = sign == 0 ? offset[axis] : -offset[axis];
+            bool reaches = true;
+            for (int other = 0; other < 3; other++) {
+                if (other != axis && major - std::abs(offset[other]) < -radius * std::sqrt(2.0f)) {
+                    reaches = false;
+                }
+            }
+            if (reaches) {
+                mask |= 1 << (2 * axis + sign);
+            }
+        }
+    }
+    return mask;
+}
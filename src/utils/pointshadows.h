@@ -0,0 +1,104 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "scenedata.h"
+
+// Shadow cubes of the point lights, rendered in a single layered pass per light (see
+// pointshadow.geom) into cube map arrays. There is one array per resolution tier: every frame the
+// lights are ranked by how large their sphere of influence is on screen, and the most important
+// ones get the cubes of the sharpest tier.
+//
+// Faces are cached. Each light keeps a mask of faces that are out of date; a face is only
+// rendered again when a caster whose bounding sphere reaches into it was added, moved or
+// removed, or when its light changes tier. Each shape is drawn only into the dirty faces it
+// reaches, so a light whose casters all sit on one side renders one or two faces.
+class PointShadows {
+public:
+    static constexpr int TierCount = 3;
+    static constexpr int TierCubes[TierCount] = {1, 3, 4};  // Cubes per tier, sharpest first
+    static constexpr int FirstTextureUnit = 9;              // Past the shadow atlas, one unit per tier
+    static constexpr int AllFaces = 0x3F;
+
+    struct Light {
+        size_t slot = 0;            // Index of the light in default.frag's arrays
+        glm::vec3 position;
+        float radius = 0.0f;        // Far plane of the cube, where the light falls below 1/256
+        float importance = 0.0f;
+        int tier = -1;              // -1 while the light has no cube
+        int cube = 0;               // Cube index within the tier's array
+        int dirtyFaces = AllFaces;  // Bit f set if face f has to be rendered again
+        bool rendered = false;      // Every face has been rendered at least once
+    };
+
+    // The program to render with, pointshadow.vert + pointshadow.geom + pointshadow.frag. Owned by
+    // the caller, it may be replaced between frames, e.g. when the shaders are reloaded.
+    void setProgram(GLuint program);
+
+    // The point lights among the lights uploaded to default.frag, in order. Cubes of the sharpest
+    // tier have baseSize texels per side, each following tier half of the one before.
+    void setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, int baseSize,
+                   const glm::vec3 &sceneCenter, float sceneRadius);
+
+    // Every face is rendered again, e.g. because the shapes were retessellated.
+    void invalidate();
+
+    // Bounding spheres of the shapes, in the same order every frame. Faces reached by a sphere
+    // that differs from the last call are rendered again.
+    void updateCasters(const std::vector<glm::vec4> &casters);
+
+    // Ranks the lights by importance as seen from camera and moves them between tiers.
+    void updateImportance(const glm::vec3 &camera);
+
+    bool needsRendering() const;
+
+    // Allocates the cube map arrays on first use. Requires a current context.
+    void allocate();
+
+    // Clears the dirty faces of light i and prepares the program to render into them.
+    void beginLight(size_t i);
+    // Restricts the next draw to the dirty faces of light i that bounds reaches, returns false if there are none.
+    bool setCaster(size_t i, const glm::vec4 &bounds, const glm::mat4 &modelMatrix);
+    void endLight(size_t i);
+    // Restores the state changed by beginLight.
+    void end();
+
+    // Binds the cube map arrays and sets the point shadow uniforms of default.frag compiled with SHADOWS.
+    void use(GLuint program) const;
+
+    void destroy();
+
+    const std::vector<Light> &lights() const { return m_lights; }
+
+    // Bit f set if a sphere reaches into face f of the cube around light
+    static int faceMask(const Light &light, const glm::vec4 &sphere);
+
+private:
+    void invalidate(const glm::vec4 &sphere);
+    int tierSize(int tier) const { return std::max(16, m_baseSize >> tier); }
+
+    GLuint m_program = 0;
+    GLint m_faceMatricesLocation = -1;
+    GLint m_firstLayerLocation = -1;
+    GLint m_faceMaskLocation = -1;
+    GLint m_lightPositionLocation = -1;
+    GLint m_farPlaneLocation = -1;
+    GLint m_modelLocation = -1;
+
+    GLuint m_fbo = 0;                       // Layered, the whole array of one tier
+    GLuint m_clearFbo = 0;                  // One face at a time
+    GLuint m_textures[TierCount] = {};
+    int m_allocatedSize = 0;
+
+    std::vector<Light> m_lights;
+    std::vector<glm::vec4> m_casters;
+    int m_baseSize = 1024;
+};
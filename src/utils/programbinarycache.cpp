@@ -0,0 +1,138 @@
+#include "programbinarycache.h"
+
+#include <QFile>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// FNV-1a, only needs to tell sources apart, not resist attacks
+uint64_t hash(const std::string &data, uint64_t seed = 14695981039346656037ull) {
+    uint64_t h = seed;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte *value = glGetString(name);
+    return value ? reinterpret_cast<const char *>(value) : "";
+}
+
+}
+
+void ProgramBinaryCache::initialize(const std::string &directory) {
+    m_directory = directory;
+    m_driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    m_enabled = formats > 0 && !error;
+    if (!m_enabled) {
+        std::cout << "Program binary cache disabled"
+                  << (formats == 0 ? ", the driver has no binary formats" : ", could not create " + m_directory) << std::endl;
+    }
+}
+
+uint64_t ProgramBinaryCache::key(const std::string &vertexCode, const std::string &geometryCode,
+                                 const std::string &fragmentCode) const {
+    // separators so moving text from one stage to the other changes the key
+    uint64_t h = hash(m_driver);
+    h = hash("\nvertex\n", h);
+    h = hash(vertexCode, h);
+    h = hash("\ngeometry\n", h);
+    h = hash(geometryCode, h);
+    h = hash("\nfragment\n", h);
+    return hash(fragmentCode, h);
+}
+
+std::string ProgramBinaryCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+GLuint ProgramBinaryCache::load(uint64_t key) {
+    if (!m_enabled) {
+        return 0;
+    }
+    std::string path = pathFor(key);
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_misses++;
+        return 0;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    FileHeader header;
+    bool valid = static_cast<size_t>(data.size()) >= sizeof(FileHeader);
+    if (valid) {
+        std::memcpy(&header, data.constData(), sizeof(FileHeader));
+        valid = std::memcmp(header.magic, "PBIN", 4) == 0 && header.version == Version && header.key == key
+                && static_cast<size_t>(data.size()) == sizeof(FileHeader) + header.length;
+    }
+
+    GLuint program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, data.constData() + sizeof(FileHeader), header.length);
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (program == 0) {
+        // truncated, from another version, or the driver no longer accepts it
+        std::cout << "discarding stale program binary " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        m_misses++;
+        return 0;
+    }
+    m_hits++;
+    return program;
+}
+
+void ProgramBinaryCache::store(uint64_t key, GLuint program) {
+    if (!m_enabled) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> data(sizeof(FileHeader) + length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, data.data() + sizeof(FileHeader));
+
+    FileHeader header = {{'P', 'B', 'I', 'N'}, Version, key, format, static_cast<uint32_t>(length)};
+    std::memcpy(data.data(), &header, sizeof(FileHeader));
+
+    std::string path = pathFor(key);
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data.data(), data.size()) != static_cast<qint64>(data.size())) {
+        std::cout << "could not write program binary " << path << std::endl;
+    }
+}
+
+void ProgramBinaryCache::clear() {
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(m_directory, error)) {
+        if (entry.path().extension() == ".bin") {
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+// Linked program binaries stored on disk (glGetProgramBinary / glProgramBinary), so programs that
+// were compiled on an earlier run load without compiling. An entry is keyed by a hash of the full
+// shader sources, defines included, and of the driver's vendor, renderer and version strings, so
+// editing a shader or updating the driver simply misses. A binary the driver rejects anyway is
+// deleted and recompiled.
+class ProgramBinaryCache {
+public:
+    // Requires a current context. Disables the cache if the driver has no binary formats.
+    void initialize(const std::string &directory);
+
+    bool enabled() const { return m_enabled; }
+
+    // Hash identifying a program built from these sources on this driver. geometryCode is empty
+    // for programs without a geometry stage.
+    uint64_t key(const std::string &vertexCode, const std::string &geometryCode, const std::string &fragmentCode) const;
+
+    // The cached program for key, or 0 if there is none or the driver rejected it.
+    GLuint load(uint64_t key);
+
+    // The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+    void store(uint64_t key, GLuint program);
+
+    // Deletes every cached binary.
+    void clear();
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+    static constexpr uint32_t Version = 1;
+
+    std::string pathFor(uint64_t key) const;
+
+    std::string m_directory;
+    std::string m_driver;
+    bool m_enabled = false;
+    int m_hits = 0;
+    int m_misses = 0;
+};
@@ -0,0 +1,147 @@
+#include "rendertargetmanager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void RenderTargetManager::resize(int width, int height, double devicePixelRatio) {
+    m_outputWidth = std::max(1, static_cast<int>(std::lround(width * devicePixelRatio)));
+    m_outputHeight = std::max(1, static_cast<int>(std::lround(height * devicePixelRatio)));
+    m_sinceResize.restart();
+    m_resizePending = true;
+}
+
+void RenderTargetManager::setScale(float scale) {
+    m_scale = std::clamp(scale, 0.1f, 2.0f);
+}
+
+void RenderTargetManager::setSamples(int samples) {
+    m_requestedSamples = std::max(1, samples);
+}
+
+bool RenderTargetManager::update() {
+    // keep stretching the old buffer while the widget is still being resized
+    if (m_fbo != 0 && m_resizePending && m_sinceResize.elapsed() < SettleMs) {
+        return false;
+    }
+    m_resizePending = false;
+
+    int width = std::max(1, static_cast<int>(std::lround(m_outputWidth * m_scale)));
+    int height = std::max(1, static_cast<int>(std::lround(m_outputHeight * m_scale)));
+    if (m_fbo != 0 && width == m_internalWidth && height == m_internalHeight && m_requestedSamples == m_allocatedRequest
+        && m_floatDepth == m_allocatedFloatDepth) {
+        return false;
+    }
+    allocate(width, height);
+    return true;
+}
+
+void RenderTargetManager::allocate(int width, int height) {
+    release();
+    m_internalWidth = std::max(1, width);
+    m_internalHeight = std::max(1, height);
+
+    GLint maxSamples = 1;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    int samples = std::min(m_requestedSamples, static_cast<int>(maxSamples));
+    GLenum depthFormat = m_floatDepth ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+    m_allocatedFloatDepth = m_floatDepth;
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_internalWidth, m_internalHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // set linear interpolation, the output may be a different size while a resize settles
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // post-processing samples around each pixel, so don't wrap to the other side
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+
+    if (samples > 1) {
+        // the scene is drawn into these, the texture above only receives the resolve and needs no depth
+        glGenRenderbuffers(1, &m_msaaColor);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_msaaColor);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, m_internalWidth, m_internalHeight);
+
+        glGenRenderbuffers(1, &m_depthStencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, depthFormat, m_internalWidth, m_internalHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        // the driver may have picked more samples than requested
+        glBindRenderbuffer(GL_RENDERBUFFER, m_msaaColor);
+        GLint actualSamples = samples;
+        glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &actualSamples);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        m_samples = std::max(samples, static_cast<int>(actualSamples));
+
+        glGenFramebuffers(1, &m_msaaFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_msaaFbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_msaaColor);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+    }
+    else {
+        glGenRenderbuffers(1, &m_depthStencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, m_internalWidth, m_internalHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        m_samples = 1;
+
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "scene framebuffer is incomplete at " << m_internalWidth << "x" << m_internalHeight
+                  << " with " << m_samples << " samples" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // compared against the request rather than m_samples, so a count the driver rounds or clamps doesn't reallocate every frame
+    m_allocatedRequest = m_requestedSamples;
+
+    std::cout << "Scene buffer: " << m_internalWidth << "x" << m_internalHeight;
+    if (m_samples > 1) {
+        std::cout << ", " << m_samples << "x MSAA";
+    }
+    if (m_allocatedFloatDepth) {
+        std::cout << ", float depth";
+    }
+    std::cout << " (output " << m_outputWidth << "x" << m_outputHeight << ")" << std::endl;
+}
+
+void RenderTargetManager::resolve() {
+    if (m_msaaFbo == 0) {
+        return;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_msaaFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glBlitFramebuffer(0, 0, m_internalWidth, m_internalHeight, 0, 0, m_internalWidth, m_internalHeight,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTargetManager::release() {
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteRenderbuffers(1, &m_depthStencil);
+        glDeleteTextures(1, &m_texture);
+    }
+    if (m_msaaFbo != 0) {
+        glDeleteFramebuffers(1, &m_msaaFbo);
+        glDeleteRenderbuffers(1, &m_msaaColor);
+    }
+    m_fbo = 0;
+    m_texture = 0;
+    m_depthStencil = 0;
+    m_msaaFbo = 0;
+    m_msaaColor = 0;
+}
+
+void RenderTargetManager::destroy() {
+    release();
+}
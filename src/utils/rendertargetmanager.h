@@ -0,0 +1,84 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <QElapsedTimer>
+
+// Owns the offscreen framebuffer the scene is rendered into and keeps it matched to the widget.
+// Sizes are tracked in physical pixels (widget size times the device pixel ratio). While the
+// widget is being resized, the old buffer keeps being used and stretched to the output, and it is
+// only reallocated once the size has stopped changing for SettleMs, so dragging a window corner
+// doesn't reallocate on every frame. The scene can also be rendered at a fraction of the output
+// resolution, the post-processing chain upscales it when it draws into the output, or be
+// multisampled, in which case it is drawn into multisampled renderbuffers and resolved into the
+// texture the post-processing chain reads.
+class RenderTargetManager {
+public:
+    static constexpr qint64 SettleMs = 200;
+
+    // Widget size in device-independent pixels, and the ratio to physical pixels.
+    void resize(int width, int height, double devicePixelRatio);
+
+    // Internal resolution as a fraction of the output, applied on the next update().
+    // Values above 1 supersample.
+    void setScale(float scale);
+    float scale() const { return m_scale; }
+
+    // MSAA samples per pixel, 1 disables it. The driver may round up, see samples().
+    void setSamples(int samples);
+    int samples() const { return m_samples; }
+
+    // 32-bit float instead of 24-bit fixed point depth, applied on the next update(). Reversed-Z
+    // only gains precision with a float depth buffer.
+    void setFloatDepth(bool floatDepth) { m_floatDepth = floatDepth; }
+    bool floatDepth() const { return m_allocatedFloatDepth; }
+
+    // Allocates the scene buffer on first use, and reallocates it once a resize has settled or the scale changed.
+    // Returns true if the buffer changed. Call once per frame with the context current.
+    bool update();
+
+    // Resolves the multisampled scene into sceneTexture(), nothing to do without MSAA.
+    void resolve();
+
+    void destroy();
+
+    // Framebuffer to draw the scene into, and the single-sampled texture holding it after resolve()
+    GLuint sceneFbo() const { return m_msaaFbo != 0 ? m_msaaFbo : m_fbo; }
+    GLuint sceneTexture() const { return m_texture; }
+
+    // Physical size of the widget's own framebuffer
+    int outputWidth() const { return m_outputWidth; }
+    int outputHeight() const { return m_outputHeight; }
+
+    // Resolution the scene is actually rendered at
+    int internalWidth() const { return m_internalWidth; }
+    int internalHeight() const { return m_internalHeight; }
+
+private:
+    void allocate(int width, int height);
+    void release();
+
+    int m_outputWidth = 0;
+    int m_outputHeight = 0;
+    int m_internalWidth = 0;
+    int m_internalHeight = 0;
+    float m_scale = 1.0f;
+    int m_requestedSamples = 1;
+    int m_allocatedRequest = 1;
+    int m_samples = 1;
+    bool m_floatDepth = false;
+    bool m_allocatedFloatDepth = false;
+
+    GLuint m_fbo = 0;
+    GLuint m_texture = 0;
+    GLuint m_depthStencil = 0;
+    GLuint m_msaaFbo = 0;
+    GLuint m_msaaColor = 0;
+
+    QElapsedTimer m_sinceResize;
+    bool m_resizePending = false;
+};
@@ -66,6 +66,7 @@ struct SceneLightData {
     glm::vec3 function; // Attenuation function
 
     glm::vec4 pos; // Position with CTM applied (Not applicable to directional lights)
+    glm::dvec4 worldPos; // pos in double precision, see RenderShapeData::worldCtm
     glm::vec4 dir; // Direction with CTM applied (Not applicable to point lights)
 
     float penumbra; // Only applicable to spot lights, in RADIANS
@@ -161,16 +162,19 @@ struct ScenePrimitive {
 struct SceneTransformation {
     TransformationType type;
 
-    glm::vec3 translate; // Only applicable when translating. Defines t_x, t_y, and t_z, the amounts to translate by, along each axis.
+    glm::dvec3 translate; // Only applicable when translating. Defines t_x, t_y, and t_z, the amounts to translate by, along each axis.
     glm::vec3 scale;     // Only applicable when scaling.     Defines s_x, s_y, and s_z, the amounts to scale by, along each axis.
     glm::vec3 rotate;    // Only applicable when rotating.    Defines the axis of rotation; should be a unit vector.
     float angle;         // Only applicable when rotating.    Defines the angle to rotate by in RADIANS, following the right-hand rule.
-    glm::mat4 matrix;    // Only applicable when transforming by a custom matrix. This is that custom matrix.
+    glm::dmat4 matrix;   // Only applicable when transforming by a custom matrix. This is that custom matrix.
 };
 
 // Struct which represents a node in the scene graph/tree, to be parsed by the student's `SceneParser`.
 struct SceneNode {
     std::vector<SceneTransformation*> transformations; // Note the order of transformations described in lab 5
+    // In double, so translations far from the origin survive until the ctm is rebased to the camera
+    glm::dmat4 localTransform = glm::dmat4(1.0);       // All of the above transformations, precomposed in order
+    glm::dmat4 localInverse = glm::dmat4(1.0);         // Inverse of localTransform, composed from the inverse of each piece
     std::vector<ScenePrimitive*> primitives;
     std::vector<SceneLight*> lights;
     std::vector<SceneNode*> children;
@@ -682,7 +682,7 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
         SceneTransformation *matrixTransformation = new SceneTransformation();
         matrixTransformation->type = TransformationType::TRANSFORMATION_MATRIX;
 
-        float *matrixPtr = glm::value_ptr(matrixTransformation->matrix);
+        double *matrixPtr = glm::value_ptr(matrixTransformation->matrix);
         int rowIndex = 0;
         for (auto row : matrixArray) {
             if (!row.isArray()) {
@@ -704,7 +704,7 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
                 }
 
                 // fill in column-wise
-                matrixPtr[colIndex * 4 + rowIndex] = (float)val.toDouble();
+                matrixPtr[colIndex * 4 + rowIndex] = val.toDouble();
                 colIndex++;
             }
             rowIndex++;
@@ -713,6 +713,8 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
         node->transformations.push_back(matrixTransformation);
     }
 
+    composeTransformations(node);
+
     // parse lights if any
     if (object.contains("lights")) {
         if (!object["lights"].isArray()) {
@@ -761,6 +763,38 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
     return true;
 }
 
+/**
+ * Collapse the node's transformation list into a single local matrix, applied in list order.
+ * The inverse is built alongside from the inverse of each piece (in reverse order), so that
+ * only custom matrices ever need an actual matrix inversion.
+ */
+void ScenefileReader::composeTransformations(SceneNode *node) {
+    glm::dmat4 local = glm::dmat4(1.0);
+    glm::dmat4 inverse = glm::dmat4(1.0);
+    for (const SceneTransformation *transformation : node->transformations) {
+        switch (transformation->type) {
+        case TransformationType::TRANSFORMATION_TRANSLATE:
+            local = glm::translate(local, transformation->translate);
+            inverse = glm::translate(glm::dmat4(1.0), -transformation->translate) * inverse;
+            break;
+        case TransformationType::TRANSFORMATION_SCALE:
+            local = glm::scale(local, glm::dvec3(transformation->scale));
+            inverse = glm::scale(glm::dmat4(1.0), 1.0 / glm::dvec3(transformation->scale)) * inverse;
+            break;
+        case TransformationType::TRANSFORMATION_ROTATE:
+            local = glm::rotate(local, double(transformation->angle), glm::dvec3(transformation->rotate));
+            inverse = glm::rotate(glm::dmat4(1.0), -double(transformation->angle), glm::dvec3(transformation->rotate)) * inverse;
+            break;
+        case TransformationType::TRANSFORMATION_MATRIX:
+            local = local * transformation->matrix;
+            inverse = glm::inverse(transformation->matrix) * inverse;
+            break;
+        }
+    }
+    node->localTransform = local;
+    node->localInverse = inverse;
+}
+
 bool ScenefileReader::parseGroups(const QJsonValue &groups, SceneNode *parent) {
     if (!groups.isArray()) {
         std::cout << "groups must be of type array" << std::endl;
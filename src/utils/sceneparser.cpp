@@ -1,32 +1,28 @@
 #include "sceneparser.h"
 #include "scenefilereader.h"
+#include "transform.h"
+#include "benchmark.h"
 #include <glm/gtx/transform.hpp>
 
 #include <chrono>
+#include <cmath>
 #include <iostream>
 
 
 
-void traverseSceneGraph(const SceneNode* node, const glm::mat4& parentTransform, RenderData& renderData) {
+void traverseSceneGraph(const SceneNode* node, const glm::dmat4& parentTransform, const glm::dmat4& parentInverse, RenderData& renderData) {
     // return if self is null
     if (node == nullptr) return;
 
-    glm::mat4 ctm = parentTransform;
-
-    // Apply transformations in the order: TRS
-    for (const auto& transformation : node->transformations) {
-        if (transformation->type == TransformationType::TRANSFORMATION_SCALE) {
-            ctm = glm::scale(ctm, transformation->scale);
-        }
-
-        if (transformation->type == TransformationType::TRANSFORMATION_ROTATE) {
-            ctm = glm::rotate(ctm, transformation->angle, transformation->rotate);
-        }
-
-        if (transformation->type == TransformationType::TRANSFORMATION_TRANSLATE) {
-            ctm = glm::translate(ctm, transformation->translate);
-        }
-    }
+    // the node's transformations were precomposed in file order by the reader,
+    // and the inverse is carried down the graph alongside the ctm: (P * L)^-1 = L^-1 * P^-1
+    // both are composed in double, a float product drifts by centimeters kilometers from the origin;
+    // the float copies are what gets uploaded outside of large-world mode
+    glm::dmat4 worldCtm = parentTransform * node->localTransform;
+    glm::dmat4 worldInverse = node->localInverse * parentInverse;
+    glm::mat4 ctm = glm::mat4(worldCtm);
+    glm::mat4 inverseCtm = glm::mat4(worldInverse);
+    glm::mat3 normalMatrix = Transform::normalMatrix(inverseCtm);
 
     // assign primitives and ctm to shapeData
     for (const auto& primitive : node->primitives) {
@@ -34,8 +30,9 @@ void traverseSceneGraph(const SceneNode* node, const glm::mat4& parentTransform,
         shapeData.primitive = *primitive;
         shapeData.primitive.material.textureMap.isUsed = false;
         shapeData.ctm = ctm;
-        shapeData.inverse_ctm = glm::inverse(ctm);
-        shapeData.inverse_transpose_ctm3 = glm::inverse(glm::transpose(glm::mat3(ctm)));
+        shapeData.worldCtm = worldCtm;
+        shapeData.inverse_ctm = inverseCtm;
+        shapeData.inverse_transpose_ctm3 = normalMatrix;
         renderData.shapes.push_back(shapeData);
     }
 
@@ -48,6 +45,7 @@ void traverseSceneGraph(const SceneNode* node, const glm::mat4& parentTransform,
         lightData.type = light->type;
         lightData.color = light->color;
         lightData.function = light->function;
+        lightData.worldPos = worldCtm * glm::dvec4(0.0, 0.0, 0.0, 1.0);
 
         // Handle different types of lights
         switch (light->type) {
@@ -74,10 +72,38 @@ void traverseSceneGraph(const SceneNode* node, const glm::mat4& parentTransform,
 
     // Recur for each child of the current node.
     for (const auto& child : node->children) {
-        traverseSceneGraph(child, ctm, renderData);
+        traverseSceneGraph(child, worldCtm, worldInverse, renderData);
+    }
+}
+
+namespace {
+
+// The traversal as it was before the inverses were carried down the graph: the ctm alone is
+// composed, and inverted twice per shape. Only kept to compare against in benchmarkFlatten, whose
+// graph has no lights.
+void traverseSceneGraphPerShapeInverse(const SceneNode* node, const glm::dmat4& parentTransform, RenderData& renderData) {
+    if (node == nullptr) return;
+
+    glm::dmat4 worldCtm = parentTransform * node->localTransform;
+    glm::mat4 ctm = glm::mat4(worldCtm);
+    for (const auto& primitive : node->primitives) {
+        RenderShapeData shapeData;
+        shapeData.primitive = *primitive;
+        shapeData.primitive.material.textureMap.isUsed = false;
+        shapeData.ctm = ctm;
+        shapeData.worldCtm = worldCtm;
+        shapeData.inverse_ctm = glm::inverse(ctm);
+        shapeData.inverse_transpose_ctm3 = glm::inverse(glm::transpose(glm::mat3(ctm)));
+        renderData.shapes.push_back(shapeData);
+    }
+
+    for (const auto& child : node->children) {
+        traverseSceneGraphPerShapeInverse(child, worldCtm, renderData);
     }
 }
 
+}
+
 bool SceneParser::parse(std::string filepath, RenderData &renderData) {
     ScenefileReader fileReader = ScenefileReader(filepath);
     bool success = fileReader.readJSON();
@@ -95,8 +121,59 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
     renderData.shapes.clear();
     renderData.lights.clear();
 
-    glm::mat4 identity = glm::mat4(1.0f); // Identity matrix
-    traverseSceneGraph(fileReader.getRootNode(), identity, renderData);
+    glm::dmat4 identity = glm::dmat4(1.0); // Identity matrix
+    traverseSceneGraph(fileReader.getRootNode(), identity, identity, renderData);
 
     return true;
 }
+
+void SceneParser::benchmarkFlatten(int numShapes) {
+    // a two level graph: sqrt(n) groups, each holding sqrt(n) leaves with one primitive
+    int fanout = std::max(1, static_cast<int>(std::sqrt(static_cast<float>(numShapes))));
+    int numGroups = (numShapes + fanout - 1) / fanout;
+
+    ScenePrimitive primitive;
+    primitive.type = PrimitiveType::PRIMITIVE_CUBE;
+    primitive.material.clear();
+
+    std::vector<SceneNode> nodes(1 + numGroups + numShapes);
+    SceneNode &root = nodes[0];
+    int next = 1 + numGroups;
+    for (int g = 0; g < numGroups; g++) {
+        SceneNode &group = nodes[1 + g];
+        group.localTransform = glm::translate(glm::dvec3(g, 0.0, 0.0)) * glm::rotate(0.01 * g, glm::dvec3(0.0, 1.0, 0.0));
+        group.localInverse = glm::rotate(-0.01 * g, glm::dvec3(0.0, 1.0, 0.0)) * glm::translate(glm::dvec3(-g, 0.0, 0.0));
+        root.children.push_back(&group);
+
+        for (int i = 0; i < fanout && next < static_cast<int>(nodes.size()); i++) {
+            SceneNode &leaf = nodes[next++];
+            glm::dvec3 scale = glm::dvec3(1.0 + 0.001 * i);
+            leaf.localTransform = glm::translate(glm::dvec3(0.0, i, 0.0)) * glm::scale(scale);
+            leaf.localInverse = glm::scale(1.0 / scale) * glm::translate(glm::dvec3(0.0, -i, 0.0));
+            leaf.primitives.push_back(&primitive);
+            group.children.push_back(&leaf);
+        }
+    }
+
+    RenderData renderData;
+    renderData.shapes.reserve(numShapes);
+    glm::dmat4 identity = glm::dmat4(1.0);
+
+    Benchmark::run("flatten " + std::to_string(numShapes) + " shapes", 5, [&]() {
+        renderData.shapes.clear();
+        traverseSceneGraph(&root, identity, identity, renderData);
+    });
+
+    // the previous approach: the same traversal, with two general inverses per shape
+    Benchmark::run("flatten " + std::to_string(numShapes) + " shapes: old per-shape glm::inverse pair", 5, [&]() {
+        renderData.shapes.clear();
+        traverseSceneGraphPerShapeInverse(&root, identity, renderData);
+    });
+
+    // and the fallback used for custom matrices
+    Benchmark::run("SIMD affine inverse x" + std::to_string(numShapes), 5, [&]() {
+        for (auto &shape : renderData.shapes) {
+            shape.inverse_ctm = Transform::affineInverse(shape.ctm);
+        }
+    });
+}
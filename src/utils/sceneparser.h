@@ -5,15 +5,19 @@
 #include <string>
 #include <OpenGL/gl.h>
 
+struct Mesh;
+
 // Struct which contains data for a single primitive, to be used for rendering
 struct RenderShapeData {
     ScenePrimitive primitive;
     glm::mat4 ctm; // the cumulative transformation matrix
     glm::mat4 inverse_ctm;
     glm::mat3 inverse_transpose_ctm3;
+    glm::dmat4 worldCtm; // ctm in double precision, rebased to the camera in large-world mode
 
     GLuint vbo = 0;
     GLuint vao = 0;
+    const Mesh *mesh = nullptr; // Shared mesh, only for PRIMITIVE_MESH
 };
 
 // Struct which contains all the data needed to render a scene
@@ -32,4 +36,7 @@ public:
     // @param renderData  On return, this will contain the metadata of the loaded scene.
     // @return            A boolean value indicating whether the parse was successful.
     static bool parse(std::string filepath, RenderData &renderData);
+
+    // Time flattening a synthetic scene graph of numShapes primitives and print the results.
+    static void benchmarkFlatten(int numShapes);
 };
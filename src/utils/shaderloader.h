@@ -11,21 +11,139 @@
 
 class ShaderLoader{
 public:
-    static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path){
-        // Create and compile the shaders.
-        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
-        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+    // Shaders are compiled into the binary as Qt resources under this prefix, see CMakeLists.txt.
+    static constexpr const char *ResourcePrefix = ":/resources/shaders/";
 
-        // Link the shader program.
+    // Files in directory are read instead of the resources with the same name, so shaders can be
+    // edited without rebuilding. Empty (the default) reads only the resources.
+    static void setOverrideDirectory(const QString &directory){
+        overrideDirectory() = directory;
+    }
+
+    // The file a resource path is actually read from.
+    static QString resolveShaderPath(const QString &filepath){
+        const QString &directory = overrideDirectory();
+        if (!directory.isEmpty() && filepath.startsWith(ResourcePrefix)) {
+            QString overridePath = directory + "/" + filepath.mid(QString(ResourcePrefix).length());
+            if (QFile::exists(overridePath)) {
+                return overridePath;
+            }
+        }
+        return filepath;
+    }
+
+    // defines, if any, are inserted right after the #version line of both shaders.
+    static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path, const std::string &defines = ""){
+        return createShaderProgramFromSource(readShaderSource(vertex_file_path, defines),
+                                             readShaderSource(fragment_file_path, defines));
+    }
+
+    // Set retrievable if the program binary will be read back with glGetProgramBinary.
+    static GLuint createShaderProgramFromSource(const std::string &vertex_code, const std::string &fragment_code, bool retrievable = false){
+        GLuint programID = beginShaderProgram(vertex_code, fragment_code, retrievable);
+        finishShaderProgram(programID);
+        return programID;
+    }
+
+    // Issues the compiles and the link without querying their status, so the driver can work on
+    // several programs at once. The program can't be used before finishShaderProgram.
+    static GLuint beginShaderProgram(const std::string &vertex_code, const std::string &fragment_code, bool retrievable = false){
+        return beginShaderProgram(vertex_code, "", fragment_code, retrievable);
+    }
+
+    // Same, with a geometry shader between the two unless geometry_code is empty.
+    static GLuint beginShaderProgram(const std::string &vertex_code, const std::string &geometry_code,
+                                     const std::string &fragment_code, bool retrievable){
         GLuint programID = glCreateProgram();
-        glAttachShader(programID, vertexShaderID);
-        glAttachShader(programID, fragmentShaderID);
+        const GLenum types[3] = {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+        const std::string *codes[3] = {&vertex_code, &geometry_code, &fragment_code};
+        for (int i = 0; i < 3; i++) {
+            if (codes[i]->empty()) {
+                continue;
+            }
+            GLuint shaderID = glCreateShader(types[i]);
+            const char *codePtr = codes[i]->c_str();
+            glShaderSource(shaderID, 1, &codePtr, nullptr);
+            glCompileShader(shaderID);
+            glAttachShader(programID, shaderID);
+        }
+
+        // Link the shader program.
+        if (retrievable) {
+            glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(programID);
+        return programID;
+    }
+
+    // True once the driver has finished a program from beginShaderProgram, so finishShaderProgram won't block.
+    // Always true without KHR/ARB_parallel_shader_compile.
+    static bool isShaderProgramComplete(GLuint programID){
+        if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile) {
+            return true;
+        }
+        GLint complete = GL_FALSE;
+        glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    // Waits for a program from beginShaderProgram and checks it. Throws with the compile or link log on failure.
+    static void finishShaderProgram(GLuint programID){
+        GLuint shaders[3];
+        GLsizei shaderCount = 0;
+        glGetAttachedShaders(programID, 3, &shaderCount, shaders);
 
         // Print the info log if error
         GLint status;
         glGetProgramiv(programID, GL_LINK_STATUS, &status);
 
+        if (status == GL_FALSE) {
+            // a failed compile shows up as a failed link, its log is the useful one
+            std::string log;
+            for (GLsizei i = 0; i < shaderCount; i++) {
+                GLint compiled;
+                glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+                if (compiled == GL_FALSE) {
+                    GLint length;
+                    glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &length);
+                    std::string shaderLog(length, '\0');
+                    glGetShaderInfoLog(shaders[i], length, nullptr, &shaderLog[0]);
+                    log += shaderLog;
+                }
+            }
+            if (log.empty()) {
+                GLint length;
+                glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+
+                log.assign(length, '\0');
+                glGetProgramInfoLog(programID, length, nullptr, &log[0]);
+            }
+
+            for (GLsizei i = 0; i < shaderCount; i++) {
+                glDeleteShader(shaders[i]);
+            }
+            glDeleteProgram(programID);
+            throw std::runtime_error(log);
+        }
+
+        // Shaders no longer necessary, stored in program
+        for (GLsizei i = 0; i < shaderCount; i++) {
+            glDetachShader(programID, shaders[i]);
+            glDeleteShader(shaders[i]);
+        }
+    }
+
+    // Compute programs need OpenGL 4.3.
+    static GLuint createComputeProgram(const char * compute_file_path, const std::string &defines = ""){
+        GLuint computeShaderID = compileShader(GL_COMPUTE_SHADER, readShaderSource(compute_file_path, defines));
+
+        GLuint programID = glCreateProgram();
+        glAttachShader(programID, computeShaderID);
+        glLinkProgram(programID);
+
+        GLint status;
+        glGetProgramiv(programID, GL_LINK_STATUS, &status);
+
         if (status == GL_FALSE) {
             GLint length;
             glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
@@ -37,20 +155,16 @@ public:
             throw std::runtime_error(log);
         }
 
-        // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        glDeleteShader(computeShaderID);
 
         return programID;
     }
 
-private:
-    static GLuint createShader(GLenum shaderType, const char *filepath){
-        GLuint shaderID = glCreateShader(shaderType);
-
+    // The code of a shader file with defines inserted after its #version line.
+    static std::string readShaderSource(const char *filepath, const std::string &defines){
         // Read shader file.
         std::string code;
-        QString filepathStr = QString(filepath);
+        QString filepathStr = resolveShaderPath(QString(filepath));
         QFile file(filepathStr);
         if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
             QTextStream stream(&file);
@@ -59,6 +173,24 @@ private:
             throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
         }
 
+        // #version has to stay the first statement
+        if (!defines.empty()) {
+            size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+            size_t insertAt = lineEnd == std::string::npos ? 0 : lineEnd + 1;
+            code.insert(insertAt, defines);
+        }
+        return code;
+    }
+
+private:
+    static QString &overrideDirectory(){
+        static QString directory;
+        return directory;
+    }
+
+    static GLuint compileShader(GLenum shaderType, const std::string &code){
+        GLuint shaderID = glCreateShader(shaderType);
+
         // Compile shader code.
         const char *codePtr = code.c_str();
         glShaderSource(shaderID, 1, &codePtr, nullptr); // Assumes code is null terminated
@@ -0,0 +1,143 @@
+#include "shaderpermutations.h"
+#include "shaderloader.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// one line per variant, the defines are newline separated
+std::string summarize(const std::string &key) {
+    std::string summary = key;
+    for (char &c : summary) {
+        if (c == '\n') {
+            c = ' ';
+        }
+    }
+    return summary;
+}
+
+}
+
+void ShaderPermutations::add(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath) {
+    m_sources[name] = Sources{vertexPath, "", fragmentPath};
+}
+
+void ShaderPermutations::add(const std::string &name, const std::string &vertexPath, const std::string &geometryPath,
+                             const std::string &fragmentPath) {
+    m_sources[name] = Sources{vertexPath, geometryPath, fragmentPath};
+}
+
+GLuint ShaderPermutations::get(const std::string &name, const std::string &defines) {
+    std::string key = keyFor(name, defines);
+    request(name, defines);
+    if (m_pending.count(key)) {
+        finish(key);
+    }
+    return m_programs.at(key);
+}
+
+void ShaderPermutations::request(const std::string &name, const std::string &defines) {
+    std::string key = keyFor(name, defines);
+    if (m_programs.count(key) || m_pending.count(key)) {
+        return;
+    }
+
+    auto sources = m_sources.find(name);
+    if (sources == m_sources.end()) {
+        throw std::runtime_error("no shader registered as " + name);
+    }
+    std::string vertexCode = ShaderLoader::readShaderSource(sources->second.vertexPath.c_str(), defines);
+    std::string geometryCode = sources->second.geometryPath.empty()
+        ? std::string() : ShaderLoader::readShaderSource(sources->second.geometryPath.c_str(), defines);
+    std::string fragmentCode = ShaderLoader::readShaderSource(sources->second.fragmentPath.c_str(), defines);
+
+    Pending pending;
+    if (m_binaryCache != nullptr && m_binaryCache->enabled()) {
+        pending.binaryKey = m_binaryCache->key(vertexCode, geometryCode, fragmentCode);
+        GLuint program = m_binaryCache->load(pending.binaryKey);
+        if (program != 0) {
+            m_programs[key] = program;
+            std::cout << "Loaded " << summarize(key) << std::endl;
+            return;
+        }
+        pending.store = true;
+    }
+    pending.program = ShaderLoader::beginShaderProgram(vertexCode, geometryCode, fragmentCode, pending.store);
+    m_pending[key] = pending;
+}
+
+GLuint ShaderPermutations::ready(const std::string &name, const std::string &defines) const {
+    auto it = m_programs.find(keyFor(name, defines));
+    return it == m_programs.end() ? 0 : it->second;
+}
+
+void ShaderPermutations::poll() {
+    bool parallel = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        std::string key = (it++)->first;
+        if (!parallel) {
+            finish(key);
+            return;
+        }
+        if (ShaderLoader::isShaderProgramComplete(m_pending[key].program)) {
+            finish(key);
+        }
+    }
+}
+
+void ShaderPermutations::finish(const std::string &key) {
+    Pending pending = m_pending[key];
+    m_pending.erase(key);
+
+    ShaderLoader::finishShaderProgram(pending.program);
+    if (pending.store) {
+        m_binaryCache->store(pending.binaryKey, pending.program);
+    }
+    m_programs[key] = pending.program;
+    std::cout << "Compiled " << summarize(key) << std::endl;
+}
+
+void ShaderPermutations::reload() {
+    std::vector<std::string> keys;
+    for (const auto &[key, program] : m_programs) {
+        keys.push_back(key);
+    }
+    for (const auto &[key, pending] : m_pending) {
+        keys.push_back(key);
+    }
+    destroy();
+
+    for (const std::string &key : keys) {
+        // the name can't contain a newline, the defines start after the first one
+        size_t split = key.find('\n');
+        request(key.substr(0, split), key.substr(split + 1));
+    }
+}
+
+void ShaderPermutations::destroy() {
+    for (auto &[key, program] : m_programs) {
+        glDeleteProgram(program);
+    }
+    m_programs.clear();
+    for (auto &[key, pending] : m_pending) {
+        // still has its shaders attached, they are deleted along with it
+        GLuint shaders[3];
+        GLsizei shaderCount = 0;
+        glGetAttachedShaders(pending.program, 3, &shaderCount, shaders);
+        for (GLsizei i = 0; i < shaderCount; i++) {
+            glDeleteShader(shaders[i]);
+        }
+        glDeleteProgram(pending.program);
+    }
+    m_pending.clear();
+}
+
+std::string ShaderPermutations::define(const std::string &macro) {
+    return "#define " + macro + "\n";
+}
+
+std::string ShaderPermutations::define(const std::string &macro, int value) {
+    return "#define " + macro + " " + std::to_string(value) + "\n";
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <map>
+#include <string>
+
+#include "programbinarycache.h"
+
+// Specialized variants of shader programs, compiled on demand and cached. A program is registered
+// once under a name with its sources; asking for it with a set of #defines compiles that variant
+// the first time (see ShaderLoader::createShaderProgram) and returns the cached one afterwards,
+// so a renderer can pick the variant matching its current features every frame.
+//
+// Variants can also be built in the background: request() issues the compile and link without
+// waiting, poll() picks up the ones the driver has finished (without blocking when
+// KHR_parallel_shader_compile is available) and ready() returns 0 until then, so the caller can
+// draw with a fallback in the meantime.
+class ShaderPermutations {
+public:
+    void add(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath);
+    // With a geometry shader, e.g. for layered rendering.
+    void add(const std::string &name, const std::string &vertexPath, const std::string &geometryPath,
+             const std::string &fragmentPath);
+
+    // Optional, variants are then loaded from and stored into cache instead of always compiling.
+    void setBinaryCache(ProgramBinaryCache *cache) { m_binaryCache = cache; }
+
+    // Compiles the variant if needed and waits for it.
+    // Throws std::runtime_error if name wasn't added or the variant fails to compile.
+    GLuint get(const std::string &name, const std::string &defines = "");
+
+    // Starts building the variant unless it is already built or being built.
+    void request(const std::string &name, const std::string &defines = "");
+
+    // The variant if it has been built, 0 otherwise. Never waits.
+    GLuint ready(const std::string &name, const std::string &defines = "") const;
+
+    // Finishes the requested variants the driver is done with. Without parallel compile support
+    // there is no way to ask, so it finishes the oldest one. Throws like get().
+    void poll();
+
+    bool pending() const { return !m_pending.empty(); }
+
+    // Deletes every variant and requests the same ones again from the current sources, e.g. after
+    // a shader file was edited. ready() returns 0 for each until it is rebuilt.
+    void reload();
+
+    // Deletes every compiled variant, the registered sources stay.
+    void destroy();
+
+    size_t variantCount() const { return m_programs.size(); }
+
+    static std::string define(const std::string &macro);
+    static std::string define(const std::string &macro, int value);
+
+private:
+    struct Sources {
+        std::string vertexPath;
+        std::string geometryPath;   // Empty if there is no geometry stage
+        std::string fragmentPath;
+    };
+
+    struct Pending {
+        GLuint program = 0;
+        uint64_t binaryKey = 0;
+        bool store = false;     // Store in the binary cache once finished
+    };
+
+    static std::string keyFor(const std::string &name, const std::string &defines) { return name + '\n' + defines; }
+    void finish(const std::string &key);
+
+    std::map<std::string, Sources> m_sources;   // By name
+    std::map<std::string, GLuint> m_programs;   // By name and defines
+    std::map<std::string, Pending> m_pending;   // Issued but not checked yet, by name and defines
+    ProgramBinaryCache *m_binaryCache = nullptr;
+};
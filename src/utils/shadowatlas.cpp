@@ -0,0 +1,268 @@
+#include "shadowatlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+static_assert(ShadowAtlas::CascadeCount == 4, "cascade_splits in default.frag is a vec4");
+
+// any up vector that isn't parallel to the light
+glm::vec3 upFor(const glm::vec3 &direction) {
+    return std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+}
+
+void ShadowAtlas::setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, int tileSize,
+                            const glm::vec3 &sceneCenter, float sceneRadius) {
+    tileSize = std::clamp(tileSize, 256, AtlasSize / 2);
+    int tilesPerRow = AtlasSize / tileSize;
+    int capacity = std::min(tilesPerRow * tilesPerRow, MaxTiles);
+
+    m_sceneCenter = sceneCenter;
+    m_sceneRadius = std::max(sceneRadius, 1.0f);
+    m_tiles.clear();
+    m_firstTile.assign(order.size(), -1);
+    m_lights.clear();
+
+    size_t unshadowed = 0;
+    for (size_t slot = 0; slot < order.size(); slot++) {
+        const SceneLightData &light = lights[order[slot]];
+        m_lights.push_back(light);
+
+        int needed = tileCount(light);
+        if (needed == 0) {
+            continue;
+        }
+        if (static_cast<int>(m_tiles.size()) + needed > capacity) {
+            unshadowed++;
+            continue;
+        }
+
+        m_firstTile[slot] = static_cast<int>(m_tiles.size());
+        for (int i = 0; i < needed; i++) {
+            Tile tile;
+            int index = static_cast<int>(m_tiles.size());
+            tile.x = (index % tilesPerRow) * tileSize;
+            tile.y = (index / tilesPerRow) * tileSize;
+            tile.size = tileSize;
+            m_tiles.push_back(tile);
+        }
+        if (light.type == LightType::LIGHT_SPOT) {
+            fitSpot(m_tiles.back(), light);
+        }
+    }
+
+    std::cout << "Shadow atlas: " << m_tiles.size() << " of " << capacity << " tiles of " << tileSize << "x" << tileSize;
+    if (unshadowed > 0) {
+        std::cout << ", " << unshadowed << " lights don't fit and stay unshadowed";
+    }
+    std::cout << std::endl;
+}
+
+void ShadowAtlas::invalidate() {
+    for (Tile &tile : m_tiles) {
+        tile.valid = false;
+    }
+}
+
+void ShadowAtlas::fitCascades(const glm::mat4 &view, const glm::mat4 &proj, float near, float far) {
+    // between logarithmic splits, which match the perspective's texel density, and even ones
+    const float lambda = 0.75f;
+    for (int c = 0; c < CascadeCount; c++) {
+        float t = static_cast<float>(c + 1) / CascadeCount;
+        m_cascadeSplits[c] = lambda * near * std::pow(far / near, t) + (1.0f - lambda) * (near + (far - near) * t);
+    }
+
+    // view space corners at depth d are (+-d * tanX, +-d * tanY, -d)
+    glm::mat4 cameraToWorld = glm::inverse(view);
+    float tanX = 1.0f / proj[0][0];
+    float tanY = 1.0f / proj[1][1];
+    m_cameraForward = -glm::normalize(glm::vec3(cameraToWorld[2]));
+
+    for (size_t slot = 0; slot < m_lights.size(); slot++) {
+        if (m_firstTile[slot] < 0 || m_lights[slot].type != LightType::LIGHT_DIRECTIONAL) {
+            continue;
+        }
+        for (int c = 0; c < CascadeCount; c++) {
+            float depths[2] = {c == 0 ? near : m_cascadeSplits[c - 1], m_cascadeSplits[c]};
+            glm::vec3 corners[8];
+            glm::vec3 center = glm::vec3(0.0f);
+            for (int i = 0; i < 8; i++) {
+                float d = depths[i / 4];
+                float x = (i & 1) ? d * tanX : -d * tanX;
+                float y = (i & 2) ? d * tanY : -d * tanY;
+                corners[i] = glm::vec3(cameraToWorld * glm::vec4(x, y, -d, 1.0f));
+                center += corners[i] / 8.0f;
+            }
+            float radius = 0.0f;
+            for (const glm::vec3 &corner : corners) {
+                radius = std::max(radius, glm::distance(center, corner));
+            }
+            // the radius only changes with near, far and the field of view, rounding keeps it exact between frames
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+            fitCascade(m_tiles[m_firstTile[slot] + c], m_lights[slot], center, radius);
+        }
+    }
+}
+
+void ShadowAtlas::fitCascade(Tile &tile, const SceneLightData &light, const glm::vec3 &center, float radius) {
+    glm::vec3 direction = glm::normalize(glm::vec3(light.dir));
+    glm::vec3 up = upFor(direction);
+    glm::mat4 rotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+    // snap the center to whole texels across the light, and to the scene's center along it,
+    // so a camera that moved less than a texel gives the same fit
+    float texel = 2.0f * radius / tile.size;
+    glm::vec3 lightCenter = glm::vec3(rotation * glm::vec4(center, 1.0f));
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+    lightCenter.z = (rotation * glm::vec4(m_sceneCenter, 1.0f)).z;
+
+    glm::vec4 key = glm::vec4(lightCenter, radius);
+    if (tile.valid && key == tile.key) {
+        return;
+    }
+    tile.key = key;
+    tile.valid = false;
+
+    // every caster is within the scene's radius of that plane
+    glm::vec3 snapped = glm::vec3(glm::inverse(rotation) * glm::vec4(lightCenter, 1.0f));
+    tile.view = glm::lookAt(snapped - direction * m_sceneRadius, snapped, up);
+    tile.proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * m_sceneRadius);
+    tile.texelSize = texel;
+    updateAtlasMatrix(tile);
+}
+
+void ShadowAtlas::fitSpot(Tile &tile, const SceneLightData &light) {
+    glm::vec3 position = glm::vec3(light.pos);
+    glm::vec3 direction = glm::normalize(glm::vec3(light.dir));
+    float far = std::max(glm::distance(position, m_sceneCenter) + m_sceneRadius, 1.0f);
+    float near = std::max(0.05f, far / 1000.0f);
+    // the outer cone plus a little, so its edge doesn't sample the clamped border
+    float fov = std::min(2.0f * light.angle + 0.1f, glm::radians(170.0f));
+
+    tile.view = glm::lookAt(position, position + direction, upFor(direction));
+    tile.proj = glm::perspective(fov, 1.0f, near, far);
+    tile.texelSize = 2.0f * std::tan(fov / 2.0f) / tile.size;
+    tile.valid = false;
+    updateAtlasMatrix(tile);
+}
+
+void ShadowAtlas::updateAtlasMatrix(Tile &tile) {
+    // from the light's clip space to the tile's rectangle in the atlas, and depth to [0, 1]
+    float scale = 0.5f * tile.size / AtlasSize;
+    glm::vec3 offset = glm::vec3((tile.x + 0.5f * tile.size) / AtlasSize, (tile.y + 0.5f * tile.size) / AtlasSize, 0.5f);
+    glm::mat4 bias = glm::translate(glm::mat4(1.0f), offset) * glm::scale(glm::mat4(1.0f), glm::vec3(scale, scale, 0.5f));
+    tile.atlasMatrix = bias * tile.proj * tile.view;
+}
+
+bool ShadowAtlas::needsRendering() const {
+    return std::any_of(m_tiles.begin(), m_tiles.end(), [](const Tile &tile) { return !tile.valid; });
+}
+
+void ShadowAtlas::allocate() {
+    if (m_fbo != 0) {
+        return;
+    }
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, AtlasSize, AtlasSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // read with sampler2DShadow, linear filtering blends four depth comparisons
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "shadow atlas framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "Shadow atlas: " << AtlasSize << "x" << AtlasSize << ", "
+              << static_cast<size_t>(AtlasSize) * AtlasSize * 4 / (1024 * 1024) << " MB" << std::endl;
+}
+
+void ShadowAtlas::beginTile(size_t i) {
+    const Tile &tile = m_tiles[i];
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(tile.x, tile.y, tile.size, tile.size);
+    // the clear only touches this tile, the others keep their cached depth
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(tile.x, tile.y, tile.size, tile.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::end() {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowAtlas::use(GLuint program, const glm::dvec3 &origin) const {
+    glActiveTexture(GL_TEXTURE0 + TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "shadow_atlas"), TextureUnit);
+
+    for (size_t i = 0; i < m_tiles.size(); i++) {
+        const Tile &tile = m_tiles[i];
+        std::string index = "[" + std::to_string(i) + "]";
+        // from origin relative positions, composed in double so the large translations cancel exactly
+        glm::mat4 atlasMatrix = glm::mat4(glm::dmat4(tile.atlasMatrix) * glm::translate(glm::dmat4(1.0), origin));
+        glUniformMatrix4fv(glGetUniformLocation(program, ("shadow_matrices" + index).c_str()), 1, GL_FALSE, &atlasMatrix[0][0]);
+        // half a texel in from the edges, so filtering never reads the neighbouring tile
+        float half = 0.5f / AtlasSize;
+        glUniform4f(glGetUniformLocation(program, ("shadow_rects" + index).c_str()),
+                    static_cast<float>(tile.x) / AtlasSize + half, static_cast<float>(tile.y) / AtlasSize + half,
+                    static_cast<float>(tile.x + tile.size) / AtlasSize - half, static_cast<float>(tile.y + tile.size) / AtlasSize - half);
+        glUniform1f(glGetUniformLocation(program, ("shadow_texel_sizes" + index).c_str()), tile.texelSize);
+    }
+
+    for (size_t slot = 0; slot < m_firstTile.size(); slot++) {
+        // a light whose tiles were never rendered would read undefined depth
+        int first = m_firstTile[slot];
+        for (int i = 0; first >= 0 && i < tileCount(m_lights[slot]); i++) {
+            if (!m_tiles[first + i].rendered) {
+                first = -1;
+            }
+        }
+        glUniform1i(glGetUniformLocation(program, ("light_shadows[" + std::to_string(slot) + "]").c_str()), first);
+    }
+
+    glUniform4f(glGetUniformLocation(program, "cascade_splits"),
+                m_cascadeSplits[0], m_cascadeSplits[1], m_cascadeSplits[2], m_cascadeSplits[3]);
+    glUniform3f(glGetUniformLocation(program, "camera_forward"), m_cameraForward.x, m_cameraForward.y, m_cameraForward.z);
+}
+
+void ShadowAtlas::destroy() {
+    if (m_fbo != 0) {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteTextures(1, &m_texture);
+    }
+    m_fbo = 0;
+    m_texture = 0;
+    for (Tile &tile : m_tiles) {
+        tile.valid = false;
+        tile.rendered = false;
+    }
+}
+
+int ShadowAtlas::tileCount(const SceneLightData &light) {
+    switch (light.type) {
+    case LightType::LIGHT_DIRECTIONAL: return CascadeCount;
+    case LightType::LIGHT_SPOT:        return 1;
+    default:                           return 0;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "scenedata.h"
+
+// Depth maps of the shadow casting lights, packed as square tiles into one depth texture.
+// A directional light gets CascadeCount tiles, each an orthographic view of the light covering a
+// slice of the camera frustum, a spot light gets one perspective tile covering its cone. Every
+// light gets tiles of the same size, so the tile size is the per-light resolution budget; lights
+// that don't fit into the atlas any more are drawn unshadowed.
+//
+// Tiles are cached: a tile is only rendered again when the casters change (invalidate()), its
+// light changes (setLights()) or, for a cascade, when the camera moved far enough that its fit
+// changes. Cascades are fitted to a bounding sphere of their frustum slice and snapped to whole
+// texels, so turning the camera or moving by less than a texel keeps the cached depth.
+class ShadowAtlas {
+public:
+    static constexpr int AtlasSize = 4096;
+    static constexpr int CascadeCount = 4;      // Must match NUM_CASCADES in default.frag
+    static constexpr int MaxTiles = 16;         // Must match MAX_SHADOW_TILES in default.frag
+    static constexpr int TextureUnit = 8;       // Past the G-buffer attachments
+
+    struct Tile {
+        int x = 0;                  // Lower left corner in atlas texels
+        int y = 0;
+        int size = 0;
+        glm::mat4 view;             // Light camera the tile is rendered with
+        glm::mat4 proj;
+        glm::mat4 atlasMatrix;      // World space to atlas uv and depth
+        float texelSize = 0.0f;     // World size of a texel; at distance 1 for perspective tiles
+        glm::vec4 key;              // What a cascade was fitted to, a different fit renders it again
+        bool valid = false;         // Holds the depth of the current casters
+        bool rendered = false;      // Has been rendered since the atlas was allocated
+    };
+
+    // Assigns tiles of tileSize texels to the lights, in the order they are uploaded to
+    // default.frag, and fits the spot lights to the scene's bounding sphere. Every tile is
+    // rendered again.
+    void setLights(const std::vector<SceneLightData> &lights, const std::vector<size_t> &order, int tileSize,
+                   const glm::vec3 &sceneCenter, float sceneRadius);
+
+    // The casters changed, e.g. the shapes were retessellated; every tile is rendered again.
+    void invalidate();
+
+    // Fits the cascades of the directional lights to the camera frustum between near and far.
+    void fitCascades(const glm::mat4 &view, const glm::mat4 &proj, float near, float far);
+
+    // True if some tile has to be rendered before the atlas matches the scene.
+    bool needsRendering() const;
+
+    // Allocates the atlas texture on first use. Requires a current context.
+    void allocate();
+
+    // Binds the atlas framebuffer with the viewport and scissor set to tile i and clears it.
+    void beginTile(size_t i);
+    void endTile(size_t i) { m_tiles[i].valid = m_tiles[i].rendered = true; }
+    // Restores the state changed by beginTile.
+    void end();
+
+    // Binds the atlas to TextureUnit and sets the shadow uniforms of default.frag compiled with SHADOWS.
+    // The shader's positions are relative to origin, see Realtime's large-world mode.
+    void use(GLuint program, const glm::dvec3 &origin = glm::dvec3(0.0)) const;
+
+    void destroy();
+
+    const std::vector<Tile> &tiles() const { return m_tiles; }
+
+private:
+    static int tileCount(const SceneLightData &light);
+    void fitSpot(Tile &tile, const SceneLightData &light);
+    void fitCascade(Tile &tile, const SceneLightData &light, const glm::vec3 &center, float radius);
+    void updateAtlasMatrix(Tile &tile);
+
+    GLuint m_fbo = 0;
+    GLuint m_texture = 0;
+
+    std::vector<Tile> m_tiles;
+    std::vector<int> m_firstTile;               // Per uploaded light, -1 if it has no tiles
+    std::vector<SceneLightData> m_lights;       // In upload order
+    float m_cascadeSplits[CascadeCount] = {};   // View depth where each cascade ends
+    glm::vec3 m_cameraForward = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 m_sceneCenter = glm::vec3(0.0f);
+    float m_sceneRadius = 1.0f;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_USE_SSE 1
+#endif
+
+namespace Transform {
+
+// True if the bottom row of m is (0, 0, 0, 1), i.e. m has no projective part.
+inline bool isAffine(const glm::mat4 &m) {
+    return m[0][3] == 0.0f && m[1][3] == 0.0f && m[2][3] == 0.0f && m[3][3] == 1.0f;
+}
+
+#ifdef TRANSFORM_USE_SSE
+// Cross product of the xyz lanes of a and b; w lane is zero when both inputs have w = 0.
+inline __m128 cross3(__m128 a, __m128 b) {
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+inline __m128 dot3(__m128 a, __m128 b) {
+    __m128 p = _mm_mul_ps(a, b);
+    __m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 z = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2));
+    return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+#endif
+
+// Inverse of an affine matrix [A t; 0 1] as [A^-1, -A^-1 t; 0 1].
+// The rows of A^-1 are the cross products of A's columns divided by det(A),
+// which avoids the cofactor expansion glm::inverse does for a general 4x4.
+inline glm::mat4 affineInverse(const glm::mat4 &m) {
+#ifdef TRANSFORM_USE_SSE
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 c0 = _mm_and_ps(_mm_loadu_ps(&m[0][0]), mask);
+    __m128 c1 = _mm_and_ps(_mm_loadu_ps(&m[1][0]), mask);
+    __m128 c2 = _mm_and_ps(_mm_loadu_ps(&m[2][0]), mask);
+    __m128 t  = _mm_and_ps(_mm_loadu_ps(&m[3][0]), mask);
+
+    __m128 r0 = cross3(c1, c2);
+    __m128 r1 = cross3(c2, c0);
+    __m128 r2 = cross3(c0, c1);
+
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), dot3(c0, r0));
+    r0 = _mm_mul_ps(r0, invDet);
+    r1 = _mm_mul_ps(r1, invDet);
+    r2 = _mm_mul_ps(r2, invDet);
+
+    // r0..r2 are the rows of A^-1, transpose them back into columns
+    __m128 r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    // -A^-1 t, with w forced to 1
+    __m128 tx = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 ty = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 tz = _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 translation = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, tx), _mm_mul_ps(r1, ty)), _mm_mul_ps(r2, tz));
+    translation = _mm_sub_ps(_mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f), translation);
+
+    glm::mat4 result;
+    _mm_storeu_ps(&result[0][0], r0);
+    _mm_storeu_ps(&result[1][0], r1);
+    _mm_storeu_ps(&result[2][0], r2);
+    _mm_storeu_ps(&result[3][0], translation);
+    return result;
+#else
+    return glm::affineInverse(m);
+#endif
+}
+
+// Inverse of an arbitrary transformation, taking the affine fast path when possible.
+inline glm::mat4 inverse(const glm::mat4 &m) {
+    return isAffine(m) ? affineInverse(m) : glm::inverse(m);
+}
+
+// Normal matrix (inverse transpose of the upper 3x3) from an already inverted CTM.
+inline glm::mat3 normalMatrix(const glm::mat4 &inverseCtm) {
+    return glm::transpose(glm::mat3(inverseCtm));
+}
+
+}